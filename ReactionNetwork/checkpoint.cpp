@@ -0,0 +1,94 @@
+#include "checkpoint.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <unistd.h>
+
+/// @brief Prints why writing `path` failed, `error` is the `errno` of the failed call
+static void
+report_failure(std::filesystem::path const& path, char const* operation, int error)
+{
+	std::cerr << "Failed to " << operation << " " << path << ": " << std::strerror(error) << std::endl;
+}
+
+/// @details The pieces are written one after another to `path.tmp`, flushed to disk with `fsync`, and then renamed onto
+/// `path`. The rename is atomic, so a process that is preempted while writing leaves the previous file intact, and the
+/// `fsync`s of the file and of its directory make sure that after a crash of the node the rename never publishes a
+/// file whose contents have not reached the disk yet. Every system call is checked and retried if a signal interrupted
+/// it; on any other error the temporary file is removed, `path` is left untouched, and the failure is reported on
+/// `std::cerr`
+bool
+write_file_atomically(std::string_view path, std::span<std::span<char const> const> pieces)
+{
+	std::filesystem::path final_path{ path };
+	std::filesystem::path temp_path{ final_path };
+	temp_path += ".tmp";
+
+	int file;
+	do
+		file = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	while (file < 0 && errno == EINTR);
+	if (file < 0)
+	{
+		report_failure(temp_path, "open", errno);
+		return false;
+	}
+
+	// Closes and removes the partially written file, so the previous contents of `path` stay in place
+	auto discard = [&](char const* operation, int error)
+	{
+		if (file >= 0) ::close(file);
+		::unlink(temp_path.c_str());
+		report_failure(temp_path, operation, error);
+		return false;
+	};
+
+	for (auto piece : pieces)
+	{
+		std::size_t written{ 0 };
+		while (written < piece.size())
+		{
+			auto count{ ::write(file, piece.data() + written, piece.size() - written) };
+			if (count < 0 && errno == EINTR) continue;
+			if (count <= 0) return discard("write", count < 0 ? errno : EIO);
+			written += static_cast<std::size_t>(count);
+		}
+	}
+
+	int synced;
+	do
+		synced = ::fsync(file);
+	while (synced != 0 && errno == EINTR);
+	if (synced != 0) return discard("flush", errno);
+
+	// `close` must not be retried, on Linux the descriptor is released even if it reports `EINTR`
+	int closed{ ::close(file) };
+	file = -1;
+	if (closed != 0 && errno != EINTR) return discard("close", errno);
+
+	std::error_code renamed;
+	std::filesystem::rename(temp_path, final_path, renamed);
+	if (renamed) return discard("rename", renamed.value());
+
+	// Persist the directory entry of the renamed file as well. The file itself is already on disk, so if this fails
+	// a crash can at worst bring back the previous checkpoint
+	auto directory_path{ final_path.has_parent_path() ? final_path.parent_path() : std::filesystem::path{ "." } };
+	int  directory{ ::open(directory_path.c_str(), O_RDONLY | O_DIRECTORY) };
+	if (directory >= 0)
+	{
+		while (::fsync(directory) != 0 && errno == EINTR)
+			;
+		::close(directory);
+	}
+	return true;
+}
+
+bool
+write_file_atomically(std::string_view path, std::span<char const> buffer)
+{
+	return write_file_atomically(path, std::span<std::span<char const> const>{ &buffer, 1 });
+}
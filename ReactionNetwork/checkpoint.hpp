@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/// @brief Identifies a file as a reaction network checkpoint, and the layout version it was written with
+constexpr char          checkpoint_magic[8] = { 'R', 'X', 'R', '8', 'C', 'K', 'P', '\0' };
+constexpr std::uint64_t checkpoint_version  = 2;
+
+/// @brief Fixed-size header at the start of every checkpoint file
+/// @details All fields are 8 bytes wide so the struct has no padding and can be written and read in a single call.
+/// The header is followed by `num_particles` instances of `ParticleCheckpoint`, one `PartialEquilibriumCheckpoint` and
+/// its `num_yields` instances of `YieldCheckpoint`.
+struct CheckpointHeader {
+	char          magic[8];
+	std::uint64_t version;
+	std::uint64_t num_particles;
+	double        tau;               // Time at which the checkpoint was written
+	double        dt;                // Size of the last time step taken
+	std::int64_t  evolution_mode;    // `EvolutionMode` as an integer
+	std::int64_t  reference_pid;     // Reference particle for `EvolutionMode::DENSITY_RATIO`
+};
+
+/// @brief Complete integrator state of a single particle
+/// @details Stores every floating point member bit-for-bit, so that restoring from a checkpoint reproduces the run
+/// exactly. The RK4 stage variables are included so that a checkpoint can be taken in the middle of a time step.
+struct ParticleCheckpoint {
+	std::int64_t  pid;
+	double        density;
+	double        eq_density;
+	double        k1;
+	double        k2;
+	double        k3;
+	double        k4;
+	std::uint64_t eq_density_calculated;
+};
+
+/// @brief Solver state of `PartialEquilibrium`, which the particle densities alone do not determine
+/// @details Written for every evolution mode; `num_yields` is zero unless the effective yields have been initialized
+struct PartialEquilibriumCheckpoint {
+	std::uint64_t num_yields;
+	std::uint64_t initialized;    // The effective yields have been taken from the particle densities
+	double        temperature;    // Temperature at the end of the last step
+	double        volume;         // Volume at the end of the last step
+};
+
+/// @brief Effective yield and chemical potential (the starting point of the next Newton solve) of one stable hadron
+struct YieldCheckpoint {
+	std::int64_t pid;
+	double       effective_number;
+	double       log_fugacity;
+};
+
+static_assert(sizeof(CheckpointHeader) == 56, "CheckpointHeader must not contain padding");
+static_assert(sizeof(ParticleCheckpoint) == 64, "ParticleCheckpoint must not contain padding");
+static_assert(sizeof(PartialEquilibriumCheckpoint) == 32, "PartialEquilibriumCheckpoint must not contain padding");
+static_assert(sizeof(YieldCheckpoint) == 24, "YieldCheckpoint must not contain padding");
+
+/// @brief Identifies a file as an `Ensemble` checkpoint, and the layout version it was written with
+constexpr char          ensemble_checkpoint_magic[8] = { 'R', 'X', 'R', '8', 'E', 'N', 'S', '\0' };
+constexpr std::uint64_t ensemble_checkpoint_version  = 1;
+
+/// @brief Fixed-size header at the start of every `Ensemble` checkpoint file
+/// @details Followed by `num_species` PIDs (`std::int64_t`), and then the densities and the four RK4 stage buffers of
+/// all cells, each as `num_cells * num_species` values of `real_bytes` bytes in the storage encoding
+struct EnsembleCheckpointHeader {
+	char          magic[8];
+	std::uint64_t version;
+	std::uint64_t real_bytes;    // sizeof(Real)
+	std::uint64_t encoding;      // `StateEncoding` as an integer
+	std::uint64_t num_cells;
+	std::uint64_t num_species;
+	double        tau;    // Time at which the checkpoint was written
+};
+
+static_assert(sizeof(EnsembleCheckpointHeader) == 56, "EnsembleCheckpointHeader must not contain padding");
+
+/// @brief Writes `buffer` to `path` such that `path` either keeps its previous contents or holds all of `buffer`
+/// @details Returns `false` if the file could not be written, in which case `path` keeps its previous contents
+[[nodiscard]] bool write_file_atomically(std::string_view path, std::span<char const> buffer);
+
+/// @brief Writes the concatenation of `pieces` to `path` like `write_file_atomically(path, buffer)`, straight from the
+/// storage of each piece without copying them into one buffer first
+[[nodiscard]] bool write_file_atomically(std::string_view path, std::span<std::span<char const> const> pieces);
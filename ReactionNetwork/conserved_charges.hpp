@@ -0,0 +1,9 @@
+#pragma once
+
+/// @brief Charges conserved by every reaction in the network
+/// @details Used both for the quantum numbers of a single particle and for the total charges of a fluid cell
+struct ConservedCharges {
+	double baryon_number{ 0.0 };
+	double strangeness{ 0.0 };
+	double electric_charge{ 0.0 };
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+/// @brief Parametrizations available for the cross section of a two-body initial state
+enum class CrossSectionModel { CONSTANT, BREIT_WIGNER };
+
+/// @brief Cross section sigma(sqrt(s)) of a two-body initial state, in mb
+/// @details Parameters for each model:
+///     - CONSTANT: (sigma_0,)
+///     - BREIT_WIGNER: (sigma_max, mass, width), sigma = sigma_max (width/2)^2 / ((sqrt(s) - mass)^2 + (width/2)^2)
+struct CrossSection {
+	double operator()(double sqrt_s) const
+	{
+		switch (model)
+		{
+			case CrossSectionModel::CONSTANT :
+				return parameters[0];
+			case CrossSectionModel::BREIT_WIGNER :
+			{
+				double half_width{ 0.5 * parameters[2] };
+				double detuning{ sqrt_s - parameters[1] };
+				return parameters[0] * half_width * half_width / (detuning * detuning + half_width * half_width);
+			}
+		}
+		return 0.0;
+	}
+
+	CrossSectionModel     model;
+	std::array<double, 3> parameters;
+};
\ No newline at end of file
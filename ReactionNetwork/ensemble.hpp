@@ -0,0 +1,516 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "conserved_charges.hpp"
+#include "particle.hpp"
+#include "profile_source.hpp"
+#include "rate_table.hpp"
+#include "reaction_network.hpp"
+
+/// @brief How the densities of an `Ensemble` are stored
+/// @details `LINEAR` stores n and the RK4 increments of n. `LOG` stores ln(n) and the RK4 increments of ln(n), which
+/// keeps the Boltzmann-suppressed densities of heavy resonances representable in `float` (whose smallest normal number
+/// is 10^-38) at the cost of an absolute, instead of relative, rounding error of the exponent
+enum class StateEncoding { LINEAR, LOG };
+
+/// @brief Default grid of the equilibrium-density tables of an `Ensemble`, accurate to about 10^-6 relative
+constexpr RateTableGrid eq_density_grid{
+	.temperature_min = 0.01, .temperature_max = 1.0, .initial_points = 16, .tolerance = 1e-6, .max_depth = 10
+};
+
+/// @brief Densities of the reaction network in many independent fluid cells, stored with precision `Real`
+/// @details The reactions are taken from the `ReactionNetwork` once and shared by all cells, each of which follows its
+/// own background profile. The state of every cell is stored as contiguous arrays of `Real` (densities and the four
+/// RK4 stage buffers), so that choosing `float` halves the memory traffic of a time step. The equilibrium densities
+/// are tabulated once per species, as ln(n_eq) + m / T on a `RateTable` grid, and interpolated in double for each cell
+/// and stage. All arithmetic is done in double: stage densities, reaction rates, the combination
+/// (k1 + 2 k2 + 2 k3 + k4) / 6 and the sums of conserved charges are accumulated in double and only rounded to `Real`
+/// when they are stored. Rates include the dilution from the expanding volume,
+///     dn_j/dt = R_j - n_j dln(V)/dt,
+/// and are integrated with the classical RK4 weights. `Ensemble<double>` serves as the reference for
+/// `accuracy_report`.
+template<typename Real, StateEncoding encoding = StateEncoding::LINEAR>
+class Ensemble
+{
+	public:
+	Ensemble(
+	    ReactionNetwork&                            network,
+	    std::vector<std::shared_ptr<ProfileSource>> profiles,
+	    RateTableGrid const&                        grid = eq_density_grid
+	);
+
+	void initialize_system(double tau_0);
+	void time_step(double dt);
+
+	bool write_checkpoint(std::string_view path) const;
+	void read_checkpoint(std::string_view path);
+
+	double           get_density(std::size_t cell, long pid) const;
+	void             set_density(std::size_t cell, long pid, double density);
+	ConservedCharges conserved_charges(std::size_t cell) const;
+
+	double get_tau(void) const { return m_tau; }
+
+	std::size_t num_cells(void) const { return m_profiles.size(); }
+
+	std::size_t num_species(void) const { return m_particles.size(); }
+
+	std::vector<long> const& get_pids(void) const { return m_pids; }
+
+	/// @brief Bytes of state stored per cell
+	std::size_t state_bytes_per_cell(void) const { return 5 * m_particles.size() * sizeof(Real); }
+
+	private:
+	/// @brief A reaction with its particles replaced by indices into the state arrays
+	struct Reaction {
+		ReactionType             reaction_type;
+		double                   reaction_rate;        // Gamma, for decays
+		double                   log_reaction_rate;    // ln(Gamma), for decays
+		RateTable const*         rate_table;
+		std::vector<std::size_t> reactants;
+		std::vector<std::size_t> products;
+	};
+
+	std::size_t index(long pid) const;
+	void        update_eq_densities(double temperature);
+	double      stored_value(double density) const;
+	double      density_value(double stored) const;
+
+	std::vector<std::shared_ptr<Particle>>      m_particles;    // Sorted by PID
+	std::vector<long>                           m_pids;
+	std::unordered_map<long, std::size_t>       m_index;
+	std::vector<Reaction>                       m_reactions;
+	std::vector<RateTable>                      m_eq_density_tables;    // ln(n_eq) + m / T, per species
+	std::vector<std::shared_ptr<ProfileSource>> m_profiles;             // One per cell
+
+	// State of all cells, indexed by cell * num_species() + species
+	std::vector<Real>                m_density;
+	std::array<std::vector<Real>, 4> m_stages;    // k1, k2, k3, k4
+
+	double m_tau{ 0.0 };
+
+	// Scratch space for a single cell, in double
+	std::vector<double> m_stage_density;
+	std::vector<double> m_log_eq_density;
+	std::vector<double> m_rate;    // R_j
+};
+
+/// @brief Deviation of a reduced-precision `Ensemble` from the double-precision run
+struct AccuracyReport {
+	double      max_relative_error{ 0.0 };    // max |n - n_ref| / n_ref over all cells and species
+	double      rms_relative_error{ 0.0 };
+	long        worst_pid{ 0 };
+	std::size_t worst_cell{ 0 };
+	double      max_charge_error{ 0.0 };      // max |N - N_ref| over cells and conserved charges
+	std::size_t non_finite_values{ 0 };       // NaN or infinite densities and charges; the errors are then infinite
+	std::size_t state_bytes{ 0 };             // Per cell, of the reduced-precision ensemble
+	std::size_t reference_state_bytes{ 0 };
+};
+
+/// @brief Builds the state arrays, flattens the reactions of `network` and tabulates the equilibrium densities
+/// @param network provides the particles and reactions, which have to be loaded before the ensemble is built
+/// @param profiles background temperature and volume of each cell
+/// @param grid temperature range and accuracy of the equilibrium-density tables; temperatures outside of the range
+/// are extrapolated, see `RateTable::log_value`
+template<typename Real, StateEncoding encoding>
+Ensemble<Real, encoding>::Ensemble(
+    ReactionNetwork&                            network,
+    std::vector<std::shared_ptr<ProfileSource>> profiles,
+    RateTableGrid const&                        grid
+)
+    : m_profiles(std::move(profiles))
+{
+	for (auto const& [key, particle] : network.get_particle_list())
+		m_particles.push_back(particle);
+	std::sort(
+	    m_particles.begin(),
+	    m_particles.end(),
+	    [](auto const& a, auto const& b) { return a->get_pid() < b->get_pid(); }
+	);
+	for (std::size_t s{ 0 }; s < m_particles.size(); ++s)
+	{
+		m_pids.push_back(m_particles[s]->get_pid());
+		m_index[m_pids.back()] = s;
+
+		auto const& particle{ m_particles[s] };
+		m_eq_density_tables.emplace_back(
+		    [&particle](double temperature) { return std::log(particle->calculate_eq_density(temperature)); },
+		    particle->get_mass(),
+		    grid
+		);
+	}
+
+	auto indices = [&](std::vector<std::shared_ptr<Particle>> const& particles)
+	{
+		std::vector<std::size_t> result;
+		for (auto const& particle : particles)
+			result.push_back(index(particle->get_pid()));
+		return result;
+	};
+	// Decays of zero width (the entries of the stable particles) do not contribute and are dropped
+	for (auto const& particle : m_particles)
+		for (auto const& reaction : particle->get_reactions())
+			if (reaction.reaction_type != ReactionType::DECAY || reaction.reaction_rate > 0.0)
+				m_reactions.push_back(Reaction{ .reaction_type     = reaction.reaction_type,
+				                                .reaction_rate     = reaction.reaction_rate,
+				                                .log_reaction_rate = std::log(reaction.reaction_rate),
+				                                .rate_table        = reaction.rate_table.get(),
+				                                .reactants         = indices(reaction.reactants),
+				                                .products          = indices(reaction.products) });
+
+	auto size{ num_cells() * num_species() };
+	m_density.assign(size, Real{ 0 });
+	for (auto& stage : m_stages)
+		stage.assign(size, Real{ 0 });
+
+	m_stage_density.resize(num_species());
+	m_log_eq_density.resize(num_species());
+	m_rate.resize(num_species());
+}
+
+template<typename Real, StateEncoding encoding>
+std::size_t
+Ensemble<Real, encoding>::index(long pid) const
+{
+	auto found = m_index.find(pid);
+	assert(found != m_index.end() && "Particle is not in the ensemble");
+	return found->second;
+}
+
+template<typename Real, StateEncoding encoding>
+double
+Ensemble<Real, encoding>::stored_value(double density) const
+{
+	if constexpr (encoding == StateEncoding::LOG)
+	{
+		assert(density > 0.0 && "Log-density storage requires positive densities");
+		return std::log(density);
+	}
+	else return density;
+}
+
+template<typename Real, StateEncoding encoding>
+double
+Ensemble<Real, encoding>::density_value(double stored) const
+{
+	if constexpr (encoding == StateEncoding::LOG) return std::exp(stored);
+	else return stored;
+}
+
+/// @brief Sets the densities in every cell to the equilibrium densities at the temperature of the cell at `tau_0`
+template<typename Real, StateEncoding encoding>
+void
+Ensemble<Real, encoding>::initialize_system(double tau_0)
+{
+	m_tau = tau_0;
+	for (std::size_t cell{ 0 }; cell < num_cells(); ++cell)
+	{
+		update_eq_densities(m_profiles[cell]->temperature(tau_0));
+		for (std::size_t s{ 0 }; s < num_species(); ++s)
+		{
+			double log_eq_density{ m_log_eq_density[s] };
+			m_density[cell * num_species() + s] =
+			    static_cast<Real>(encoding == StateEncoding::LOG ? log_eq_density : std::exp(log_eq_density));
+		}
+	}
+}
+
+/// @brief Interpolates ln(n_eq) of every species at `temperature` into the scratch space
+template<typename Real, StateEncoding encoding>
+void
+Ensemble<Real, encoding>::update_eq_densities(double temperature)
+{
+	for (std::size_t s{ 0 }; s < num_species(); ++s)
+		m_log_eq_density[s] = m_eq_density_tables[s].log_value(temperature);
+}
+
+/// @brief Performs a full Runge-Kutta 4th order time step in every cell
+/// @details Each stage sweeps over all cells, reading the stored densities and the previous stage buffer, and writing
+/// the next stage buffer, so the state is streamed through memory once per stage. The rate of each side of a reaction,
+/// C prod n/n_eq, is evaluated as exp(ln(C) - sum ln(n_eq)) prod n. The factor in front is the rate constant of that
+/// direction and stays finite when the equilibrium densities of heavy species underflow at low temperatures
+template<typename Real, StateEncoding encoding>
+void
+Ensemble<Real, encoding>::time_step(double dt)
+{
+	constexpr std::array<double, 4> stage_offsets{ 0.0, 0.5, 0.5, 1.0 };
+	auto                            n{ num_species() };
+
+	for (std::size_t stage{ 0 }; stage < 4; ++stage)
+	{
+		double offset{ stage_offsets[stage] };
+		double tau{ m_tau + offset * dt };
+		for (std::size_t cell{ 0 }; cell < num_cells(); ++cell)
+		{
+			double temperature{ m_profiles[cell]->temperature(tau) };
+			double expansion_rate{ m_profiles[cell]->expansion_rate(tau) };
+			update_eq_densities(temperature);
+
+			Real const* density{ m_density.data() + cell * n };
+			Real const* previous{ stage == 0 ? nullptr : m_stages[stage - 1].data() + cell * n };
+			Real*       current{ m_stages[stage].data() + cell * n };
+
+			for (std::size_t s{ 0 }; s < n; ++s)
+			{
+				double stored{ static_cast<double>(density[s]) };
+				if (stage != 0) stored += offset * static_cast<double>(previous[s]);
+				m_stage_density[s] = density_value(stored);
+				m_rate[s]          = 0.0;
+			}
+
+			// dn/dt = C (prod_products n/n_eq - prod_reactants n/n_eq), with C = Gamma n_eq for decays
+			for (auto const& reaction : m_reactions)
+			{
+				double log_coefficient;
+				double from_reactants;
+				if (reaction.reaction_type == ReactionType::DECAY)
+				{
+					log_coefficient = reaction.log_reaction_rate + m_log_eq_density[reaction.reactants[0]];
+					from_reactants  = reaction.reaction_rate * m_stage_density[reaction.reactants[0]];
+				}
+				else
+				{
+					log_coefficient = reaction.rate_table->log_value(temperature);
+					double log_constant{ log_coefficient };
+					for (auto reactant : reaction.reactants)
+						log_constant -= m_log_eq_density[reactant];
+					from_reactants = std::exp(log_constant);
+					for (auto reactant : reaction.reactants)
+						from_reactants *= m_stage_density[reactant];
+				}
+
+				double log_constant{ log_coefficient };
+				for (auto product : reaction.products)
+					log_constant -= m_log_eq_density[product];
+				double from_products{ std::exp(log_constant) };
+				for (auto product : reaction.products)
+					from_products *= m_stage_density[product];
+
+				double rate{ from_products - from_reactants };
+				for (auto reactant : reaction.reactants)
+					m_rate[reactant] += rate;
+				for (auto product : reaction.products)
+					m_rate[product] -= rate;
+			}
+
+			for (std::size_t s{ 0 }; s < n; ++s)
+			{
+				double derivative{ encoding == StateEncoding::LOG
+					                   ? m_rate[s] / m_stage_density[s] - expansion_rate
+					                   : m_rate[s] - m_stage_density[s] * expansion_rate };
+				current[s] = static_cast<Real>(dt * derivative);
+			}
+		}
+	}
+
+	// Combine the stages in double, and round to the storage precision once
+	for (std::size_t i{ 0 }; i < m_density.size(); ++i)
+	{
+		double increment{ (static_cast<double>(m_stages[0][i]) + 2.0 * static_cast<double>(m_stages[1][i]) +
+			               2.0 * static_cast<double>(m_stages[2][i]) + static_cast<double>(m_stages[3][i])) /
+			              6.0 };
+		m_density[i] = static_cast<Real>(static_cast<double>(m_density[i]) + increment);
+	}
+	m_tau += dt;
+}
+
+/// @brief Writes the state of all cells to a binary checkpoint file
+/// @param path location of the checkpoint file
+/// @details The values are stored as raw bits of `Real` in the storage encoding, together with the current time, so
+/// that a restarted run continues bit-for-bit. The header, the PIDs, the densities and every stage buffer are written
+/// one after another straight from their storage with `write_file_atomically`, so checkpointing needs no second copy
+/// of the state, and a run that is preempted or crashes while writing leaves the previous checkpoint intact. Returns
+/// `false` if the file cannot be written
+template<typename Real, StateEncoding encoding>
+bool
+Ensemble<Real, encoding>::write_checkpoint(std::string_view path) const
+{
+	EnsembleCheckpointHeader header{ .magic       = {},
+		                             .version     = ensemble_checkpoint_version,
+		                             .real_bytes  = sizeof(Real),
+		                             .encoding    = static_cast<std::uint64_t>(encoding),
+		                             .num_cells   = num_cells(),
+		                             .num_species = num_species(),
+		                             .tau         = m_tau };
+	std::memcpy(header.magic, ensemble_checkpoint_magic, sizeof(ensemble_checkpoint_magic));
+
+	// The PIDs are the only part that is converted, everything else is written straight from where it is stored
+	std::vector<std::int64_t> pids(m_pids.begin(), m_pids.end());
+
+	auto bytes = [](void const* data, std::size_t size)
+	{
+		return std::span<char const>(static_cast<char const*>(data), size);
+	};
+	auto values{ m_density.size() * sizeof(Real) };
+
+	std::vector<std::span<char const>> pieces{ bytes(&header, sizeof(header)),
+		                                       bytes(pids.data(), pids.size() * sizeof(std::int64_t)),
+		                                       bytes(m_density.data(), values) };
+	for (auto const& stage : m_stages)
+		pieces.push_back(bytes(stage.data(), values));
+
+	return write_file_atomically(path, pieces);
+}
+
+/// @brief Restores the state of all cells from a binary checkpoint file
+/// @param path location of the checkpoint file written by `write_checkpoint`
+/// @details The ensemble has to be built from the same network and number of cells, with the same `Real` and
+/// `StateEncoding`, as the one that wrote the checkpoint. Function can fail if the file does not exist or does not
+/// match the ensemble, and will terminate program
+template<typename Real, StateEncoding encoding>
+void
+Ensemble<Real, encoding>::read_checkpoint(std::string_view path)
+{
+	std::ifstream fin(std::filesystem::path{ path }, std::ios::in | std::ios::binary);
+	assert(fin.is_open() && "Checkpoint file failed to open");
+
+	EnsembleCheckpointHeader header;
+	fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+	assert(
+	    std::memcmp(header.magic, ensemble_checkpoint_magic, sizeof(ensemble_checkpoint_magic)) == 0 &&
+	    "Not an ensemble checkpoint file"
+	);
+	assert(header.version == ensemble_checkpoint_version && "Unsupported checkpoint version");
+	assert(
+	    header.real_bytes == sizeof(Real) && header.encoding == static_cast<std::uint64_t>(encoding) &&
+	    "Checkpoint was written with a different precision or encoding"
+	);
+	assert(
+	    header.num_cells == num_cells() && header.num_species == num_species() &&
+	    "Checkpoint does not match ensemble"
+	);
+
+	std::vector<std::int64_t> pids(header.num_species);
+	fin.read(reinterpret_cast<char*>(pids.data()), pids.size() * sizeof(std::int64_t));
+	assert(std::equal(pids.begin(), pids.end(), m_pids.begin()) && "Checkpoint does not match ensemble");
+
+	auto values{ m_density.size() * sizeof(Real) };
+	fin.read(reinterpret_cast<char*>(m_density.data()), values);
+	for (auto& stage : m_stages)
+		fin.read(reinterpret_cast<char*>(stage.data()), values);
+	assert(!fin.fail() && "Checkpoint file is truncated");
+
+	m_tau = header.tau;
+}
+
+template<typename Real, StateEncoding encoding>
+double
+Ensemble<Real, encoding>::get_density(std::size_t cell, long pid) const
+{
+	return density_value(static_cast<double>(m_density[cell * num_species() + index(pid)]));
+}
+
+template<typename Real, StateEncoding encoding>
+void
+Ensemble<Real, encoding>::set_density(std::size_t cell, long pid, double density)
+{
+	m_density[cell * num_species() + index(pid)] = static_cast<Real>(stored_value(density));
+}
+
+/// @brief Total charges N = V sum_j q_j n_j of a cell, which the reactions and the dilution conserve
+/// @details The sums are accumulated in double regardless of `Real`
+template<typename Real, StateEncoding encoding>
+ConservedCharges
+Ensemble<Real, encoding>::conserved_charges(std::size_t cell) const
+{
+	ConservedCharges total;
+	for (std::size_t s{ 0 }; s < num_species(); ++s)
+	{
+		double density{ density_value(static_cast<double>(m_density[cell * num_species() + s])) };
+		auto   charges{ m_particles[s]->get_charges() };
+		total.baryon_number += charges.baryon_number * density;
+		total.strangeness += charges.strangeness * density;
+		total.electric_charge += charges.electric_charge * density;
+	}
+
+	double volume{ m_profiles[cell]->volume(m_tau) };
+	total.baryon_number *= volume;
+	total.strangeness *= volume;
+	total.electric_charge *= volume;
+	return total;
+}
+
+/// @brief Compares a reduced-precision run against the double-precision run of the same network and cells
+/// @details Both ensembles have to be built from the same network and profiles, and advanced with the same steps.
+/// Species whose reference density is zero are skipped. NaN or infinite densities and charges of `ensemble` are
+/// counted in `non_finite_values` and make all errors infinite, with the first one reported as the worst
+template<typename Real, StateEncoding encoding, StateEncoding reference_encoding>
+AccuracyReport
+accuracy_report(Ensemble<Real, encoding> const& ensemble, Ensemble<double, reference_encoding> const& reference)
+{
+	assert(
+	    ensemble.num_cells() == reference.num_cells() && ensemble.get_pids() == reference.get_pids() &&
+	    "Ensembles have to be built from the same network and cells"
+	);
+
+	AccuracyReport report;
+	report.state_bytes           = ensemble.state_bytes_per_cell();
+	report.reference_state_bytes = reference.state_bytes_per_cell();
+
+	double      sum_squares{ 0.0 };
+	std::size_t count{ 0 };
+	for (std::size_t cell{ 0 }; cell < reference.num_cells(); ++cell)
+	{
+		for (auto pid : reference.get_pids())
+		{
+			double density{ ensemble.get_density(cell, pid) };
+			if (!std::isfinite(density))
+			{
+				if (report.non_finite_values++ == 0)
+				{
+					report.worst_pid  = pid;
+					report.worst_cell = cell;
+				}
+				continue;
+			}
+
+			double expected{ reference.get_density(cell, pid) };
+			if (expected == 0.0) continue;
+			double error{ std::fabs(density - expected) / expected };
+			sum_squares += error * error;
+			++count;
+			if (report.non_finite_values == 0 && error > report.max_relative_error)
+			{
+				report.max_relative_error = error;
+				report.worst_pid          = pid;
+				report.worst_cell         = cell;
+			}
+		}
+
+		auto charges{ ensemble.conserved_charges(cell) };
+		auto expected{ reference.conserved_charges(cell) };
+		for (auto [charge, expected_charge] : { std::pair{ charges.baryon_number, expected.baryon_number },
+		                                        std::pair{ charges.strangeness, expected.strangeness },
+		                                        std::pair{ charges.electric_charge, expected.electric_charge } })
+		{
+			if (!std::isfinite(charge)) ++report.non_finite_values;
+			else report.max_charge_error = std::max(report.max_charge_error, std::fabs(charge - expected_charge));
+		}
+	}
+	report.rms_relative_error = count == 0 ? 0.0 : std::sqrt(sum_squares / count);
+
+	if (report.non_finite_values != 0)
+	{
+		report.max_relative_error = std::numeric_limits<double>::infinity();
+		report.rms_relative_error = std::numeric_limits<double>::infinity();
+		report.max_charge_error   = std::numeric_limits<double>::infinity();
+	}
+	return report;
+}
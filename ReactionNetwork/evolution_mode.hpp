@@ -0,0 +1,9 @@
+#pragma once
+
+/// @brief Enum class that selects which variables the reaction network integrates in time
+/// @details `DENSITY` evolves the densities directly and ignores the background volume. `DENSITY_RATIO` includes the
+/// dilution from the expanding volume and evolves the ratios x_j = n_j / n_ref to a reference species together with
+/// log(n_ref), see `reaction_rate_notes/notes.tex`. `PARTIAL_EQUILIBRIUM` keeps the resonances in relative chemical
+/// equilibrium with their daughters and only evolves the effective yields of the stable hadrons, see
+/// `PartialEquilibrium`
+enum class EvolutionMode { DENSITY, DENSITY_RATIO, PARTIAL_EQUILIBRIUM };
\ No newline at end of file
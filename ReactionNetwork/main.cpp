@@ -1,5 +1,7 @@
+#include "ensemble.hpp"
 #include "particle.hpp"
 #include "print.hpp"
+#include "profile_source.hpp"
 #include "reaction_info.hpp"
 #include "reaction_network.hpp"
 #include "string_utility.hpp"
@@ -44,11 +46,52 @@ main()
 	double tau_f{ 20.0 };
 	double temperature{ 0.500 };
 
-	rn.initialize_system(tau_0, temperature);
-	for (auto tau = tau_0; tau <= tau_f; tau += dtau)
+	// Longitudinal (Bjorken) expansion, the volume grows as V ~ tau
+	AnalyticProfile bjorken(
+	    [&](double tau) -> double { return ideal_hydro_temp(tau, tau_0, temperature); },
+	    [&](double tau) -> double { return tau / tau_0; }
+	);
+
+	// Accuracy of float storage for a small ensemble of cells with different initial temperatures. Log encoding keeps
+	// the densities of the heavy resonances, which drop below the float range as the cells cool, representable
+	std::vector<std::shared_ptr<ProfileSource>> cells;
+	for (double cell_temperature : { 0.150, 0.155, 0.160, 0.165 })
+		cells.push_back(std::make_shared<AnalyticProfile>(
+		    [=](double tau) -> double { return ideal_hydro_temp(tau, tau_0, cell_temperature); },
+		    [=](double tau) -> double { return tau / tau_0; }
+		));
+	Ensemble<double>                    reference(rn, cells);
+	Ensemble<float, StateEncoding::LOG> reduced(rn, cells);
+	reference.initialize_system(tau_0);
+	reduced.initialize_system(tau_0);
+	for (int n{ 0 }; n < 50; ++n)
+	{
+		reference.time_step(dtau);
+		reduced.time_step(dtau);
+	}
+	auto report{ accuracy_report(reduced, reference) };
+	print("float ensemble: max rel. error", report.max_relative_error, "rms", report.rms_relative_error);
+	print("    worst pid", report.worst_pid, "cell", report.worst_cell, "charge error", report.max_charge_error);
+	print("    non-finite values", report.non_finite_values);
+	print("    bytes per cell", report.state_bytes, "vs", report.reference_state_bytes);
+
+	// Resume from the last checkpoint if a previous run was interrupted
+	std::size_t checkpoint_interval{ 100 };
+	auto        checkpoint_file{ cwd / "checkpoint.bin" };
+	if (std::filesystem::exists(checkpoint_file)) rn.read_checkpoint(checkpoint_file.c_str());
+	else rn.initialize_system(tau_0, temperature);
+
+	std::size_t step{ 0 };
+	for (auto tau = rn.get_tau(); tau <= tau_f; tau = rn.get_tau())
 	{
-		rn.time_step(dtau, ideal_hydro_temp(tau, tau_0, temperature));
+		rn.time_step(dtau, bjorken);
 		print(tau, rn.get_particle_density(111));
+		// A failed checkpoint leaves the previous one in place, so the run continues and tries again at the next interval
+		if (++step % checkpoint_interval == 0 && !rn.write_checkpoint(checkpoint_file.c_str()))
+			print("checkpoint not written at tau", rn.get_tau());
 	}
+
+	// The run is complete, so the next run has to start from the beginning instead of resuming
+	std::filesystem::remove(checkpoint_file);
 	return 0;
 }
\ No newline at end of file
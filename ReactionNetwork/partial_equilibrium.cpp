@@ -0,0 +1,339 @@
+#include "partial_equilibrium.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+/// @brief Solves the dense n x n system `matrix` x = `rhs` in place with partial pivoting, leaving x in `rhs`
+static void
+solve_linear_system(std::vector<double>& matrix, std::vector<double>& rhs, std::size_t n)
+{
+	for (std::size_t col{ 0 }; col < n; ++col)
+	{
+		std::size_t pivot{ col };
+		for (std::size_t row{ col + 1 }; row < n; ++row)
+			if (std::fabs(matrix[row * n + col]) > std::fabs(matrix[pivot * n + col])) pivot = row;
+		if (pivot != col)
+		{
+			for (std::size_t k{ 0 }; k < n; ++k)
+				std::swap(matrix[col * n + k], matrix[pivot * n + k]);
+			std::swap(rhs[col], rhs[pivot]);
+		}
+
+		for (std::size_t row{ col + 1 }; row < n; ++row)
+		{
+			double factor{ matrix[row * n + col] / matrix[col * n + col] };
+			for (std::size_t k{ col }; k < n; ++k)
+				matrix[row * n + k] -= factor * matrix[col * n + k];
+			rhs[row] -= factor * rhs[col];
+		}
+	}
+
+	for (std::size_t row{ n }; row-- > 0;)
+	{
+		for (std::size_t k{ row + 1 }; k < n; ++k)
+			rhs[row] -= matrix[row * n + k] * rhs[k];
+		rhs[row] /= matrix[row * n + row];
+	}
+}
+
+/// @brief Sorts the particles into stable hadrons and resonances, and builds the effective-multiplicity matrix
+/// @details Particles are ordered by PID, so that the results do not depend on the iteration order of `particles`
+PartialEquilibrium::PartialEquilibrium(std::unordered_map<long, std::shared_ptr<Particle>> const& particles)
+{
+	std::vector<std::shared_ptr<Particle>> sorted;
+	for (auto const& [key, particle] : particles)
+		sorted.push_back(particle);
+	std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a->get_pid() < b->get_pid(); });
+
+	auto total_decay_rate = [](std::shared_ptr<Particle> const& particle)
+	{
+		double total{ 0.0 };
+		for (auto const& reaction : particle->get_reactions())
+			if (reaction.reaction_type == ReactionType::DECAY) total += reaction.reaction_rate;
+		return total;
+	};
+
+	std::unordered_map<long, std::size_t> stable_index;
+	for (auto const& particle : sorted)
+	{
+		if (particle->get_decay_width() == 0.0 || total_decay_rate(particle) == 0.0)
+		{
+			stable_index[particle->get_pid()] = m_stable.size();
+			m_stable.push_back(particle);
+		}
+		else m_resonances.push_back(particle);
+	}
+	assert(!m_stable.empty() && "Partial chemical equilibrium needs at least one stable particle");
+
+	// <N_i>_R = sum_channels BR sum_daughters <N_i>_daughter, where <N_i>_j = delta_ij for stable hadrons
+	std::unordered_map<long, std::vector<double>> memo;
+	std::function<std::vector<double> const&(std::shared_ptr<Particle> const&)> multiplicity =
+	    [&](std::shared_ptr<Particle> const& particle) -> std::vector<double> const&
+	{
+		auto pid{ particle->get_pid() };
+		if (auto found = memo.find(pid); found != memo.end())
+		{
+			assert(!found->second.empty() && "Decay chain contains a cycle");
+			return found->second;
+		}
+		memo[pid] = {};
+
+		std::vector<double> result(m_stable.size(), 0.0);
+		if (auto stable = stable_index.find(pid); stable != stable_index.end()) result[stable->second] = 1.0;
+		else
+		{
+			double total{ total_decay_rate(particle) };
+			for (auto const& reaction : particle->get_reactions())
+			{
+				if (reaction.reaction_type != ReactionType::DECAY) continue;
+				double branching_ratio{ reaction.reaction_rate / total };
+				for (auto const& product : reaction.products)
+				{
+					auto const& daughter{ multiplicity(product) };
+					for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+						result[i] += branching_ratio * daughter[i];
+				}
+			}
+		}
+		return memo[pid] = std::move(result);
+	};
+
+	for (auto const& resonance : m_resonances)
+		m_multiplicity.push_back(multiplicity(resonance));
+
+	// Only scatterings can change the effective yields, decays conserve them by construction
+	for (auto const& particle : sorted)
+		for (auto const& reaction : particle->get_reactions())
+		{
+			if (reaction.reaction_type == ReactionType::DECAY) continue;
+			std::vector<double> change(m_stable.size(), 0.0);
+			for (auto const& reactant : reaction.reactants)
+				for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+					change[i] += multiplicity(reactant)[i];
+			for (auto const& product : reaction.products)
+				for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+					change[i] -= multiplicity(product)[i];
+
+			bool changes_yields{ std::any_of(change.begin(), change.end(), [](double c) { return c != 0.0; }) };
+			if (changes_yields)
+				m_reactions.push_back(
+				    YieldChangingReaction{ .owner = particle, .reaction = &reaction, .change = std::move(change) }
+				);
+		}
+
+	m_effective_numbers.assign(m_stable.size(), 0.0);
+	m_log_fugacity.assign(m_stable.size(), 0.0);
+}
+
+/// @brief Sets the effective yields from the current particle densities
+/// @param temperature background temperature at the current time
+/// @param volume background volume at the current time
+void
+PartialEquilibrium::initialize(double temperature, double volume)
+{
+	m_temperature = temperature;
+	m_volume      = volume;
+	for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+		m_effective_numbers[i] = m_stable[i]->get_density();
+	for (std::size_t r{ 0 }; r < m_resonances.size(); ++r)
+		for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+			m_effective_numbers[i] += m_multiplicity[r][i] * m_resonances[r]->get_density();
+	for (auto& number : m_effective_numbers)
+		number *= volume;
+	std::fill(m_log_fugacity.begin(), m_log_fugacity.end(), 0.0);
+
+	// The equilibrium densities may have been calculated by the network at a different temperature
+	m_eq_temperature = std::numeric_limits<double>::quiet_NaN();
+}
+
+void
+PartialEquilibrium::update_eq_densities(double temperature)
+{
+	if (temperature == m_eq_temperature) return;
+	for (auto const& particle : m_stable)
+		particle->invalidate_eq_density();
+	for (auto const& particle : m_resonances)
+		particle->invalidate_eq_density();
+	m_eq_temperature = temperature;
+}
+
+/// @brief Newton's method for mu_i / T given the effective densities nbar_i
+/// @details The residual is the gradient of the convex function
+/// sum_i n_i,eq e^{lambda_i} + sum_R n_R,eq e^{<N>_R . lambda} - nbar . lambda, so the Jacobian is symmetric positive
+/// definite and the iteration converges from the previous solution. Steps are limited to 1 in each component to
+/// stay in the region where the exponentials are well approximated. `log_fugacity` holds the starting point and
+/// receives the solution. Terminates the program if it does not converge
+void
+PartialEquilibrium::solve_chemical_potentials(
+    double                     temperature,
+    std::vector<double> const& effective_densities,
+    std::vector<double>&       log_fugacity
+)
+{
+	update_eq_densities(temperature);
+
+	auto                n{ m_stable.size() };
+	std::vector<double> residual(n);
+	std::vector<double> jacobian(n * n);
+	for (int iteration{ 0 }; iteration < 100; ++iteration)
+	{
+		std::fill(jacobian.begin(), jacobian.end(), 0.0);
+		for (std::size_t i{ 0 }; i < n; ++i)
+		{
+			assert(effective_densities[i] > 0.0 && "Effective yields have to be positive");
+			double density{ m_stable[i]->get_eq_density(temperature) * std::exp(log_fugacity[i]) };
+			residual[i]         = effective_densities[i] - density;
+			jacobian[i * n + i] = density;
+		}
+		for (std::size_t r{ 0 }; r < m_resonances.size(); ++r)
+		{
+			auto const& row{ m_multiplicity[r] };
+			double      exponent{ 0.0 };
+			for (std::size_t i{ 0 }; i < n; ++i)
+				exponent += row[i] * log_fugacity[i];
+			double density{ m_resonances[r]->get_eq_density(temperature) * std::exp(exponent) };
+
+			for (std::size_t i{ 0 }; i < n; ++i)
+			{
+				if (row[i] == 0.0) continue;
+				residual[i] -= row[i] * density;
+				for (std::size_t k{ 0 }; k < n; ++k)
+					jacobian[i * n + k] += row[i] * row[k] * density;
+			}
+		}
+
+		double relative_residual{ 0.0 };
+		for (std::size_t i{ 0 }; i < n; ++i)
+			relative_residual = std::max(relative_residual, std::fabs(residual[i]) / effective_densities[i]);
+		if (relative_residual < 1e-13) return;
+
+		solve_linear_system(jacobian, residual, n);
+		double largest_step{ 0.0 };
+		for (auto step : residual)
+			largest_step = std::max(largest_step, std::fabs(step));
+		double damping{ largest_step > 1.0 ? 1.0 / largest_step : 1.0 };
+		for (std::size_t i{ 0 }; i < n; ++i)
+			log_fugacity[i] += damping * residual[i];
+	}
+	assert(false && "Chemical potentials for partial chemical equilibrium did not converge");
+}
+
+/// @brief Sets the stage densities of all particles from the chemical potentials `log_fugacity`
+void
+PartialEquilibrium::set_stage_densities(double temperature, std::vector<double> const& log_fugacity)
+{
+	for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+		m_stable[i]->set_stage_density(m_stable[i]->get_eq_density(temperature) * std::exp(log_fugacity[i]));
+	for (std::size_t r{ 0 }; r < m_resonances.size(); ++r)
+	{
+		double exponent{ 0.0 };
+		for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+			exponent += m_multiplicity[r][i] * log_fugacity[i];
+		m_resonances[r]->set_stage_density(m_resonances[r]->get_eq_density(temperature) * std::exp(exponent));
+	}
+}
+
+/// @brief d(nbar_i V)/dt at time `tau` for the effective numbers `effective_numbers`
+std::vector<double>
+PartialEquilibrium::yield_rates(double tau, std::vector<double> const& effective_numbers, ProfileSource& profile)
+{
+	std::vector<double> rates(m_stable.size(), 0.0);
+	if (m_reactions.empty()) return rates;
+
+	double temperature{ profile.temperature(tau) };
+	double volume{ profile.volume(tau) };
+
+	std::vector<double> effective_densities(effective_numbers);
+	for (auto& density : effective_densities)
+		density /= volume;
+	solve_chemical_potentials(temperature, effective_densities, m_log_fugacity);
+	set_stage_densities(temperature, m_log_fugacity);
+
+	for (auto const& [owner, reaction, change] : m_reactions)
+	{
+		double rate{ reaction->rate(owner, temperature) * volume };
+		for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+			rates[i] += rate * change[i];
+	}
+	return rates;
+}
+
+/// @brief Preforms a full Runge-Kutta 4th order time step of the effective numbers nbar_i V
+/// @details Without scatterings that change the effective yields, the effective numbers are conserved and the step
+/// only records the new temperature and volume. The particle densities are not updated, call `rebuild_densities`
+void
+PartialEquilibrium::time_step(double tau, double dt, ProfileSource& profile)
+{
+	auto                n{ m_stable.size() };
+	std::vector<double> stage(n);
+	auto                advance = [&](std::vector<double> const& k, double scale)
+	{
+		for (std::size_t i{ 0 }; i < n; ++i)
+			stage[i] = m_effective_numbers[i] + scale * dt * k[i];
+		return stage;
+	};
+
+	auto k1{ yield_rates(tau, m_effective_numbers, profile) };
+	auto k2{ yield_rates(tau + 0.5 * dt, advance(k1, 0.5), profile) };
+	auto k3{ yield_rates(tau + 0.5 * dt, advance(k2, 0.5), profile) };
+	auto k4{ yield_rates(tau + dt, advance(k3, 1.0), profile) };
+	for (std::size_t i{ 0 }; i < n; ++i)
+		m_effective_numbers[i] += dt * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]) / 6.0;
+
+	m_temperature = profile.temperature(tau + dt);
+	m_volume      = profile.volume(tau + dt);
+}
+
+/// @brief Sets the densities of all particles from the effective yields at the end of the last step
+/// @details Solves from a copy of the chemical potentials, so that rebuilding the densities for output does not change
+/// the starting point of the next solve, and with it the evolution
+void
+PartialEquilibrium::rebuild_densities(void)
+{
+	std::vector<double> effective_densities(m_effective_numbers);
+	for (auto& density : effective_densities)
+		density /= m_volume;
+	std::vector<double> log_fugacity(m_log_fugacity);
+	solve_chemical_potentials(m_temperature, effective_densities, log_fugacity);
+	set_stage_densities(m_temperature, log_fugacity);
+
+	for (auto const& particle : m_stable)
+		particle->set_density(particle->get_stage_density());
+	for (auto const& particle : m_resonances)
+		particle->set_density(particle->get_stage_density());
+}
+/// @brief Temperature and volume of the last step; the effective yields are stored with `save_yield`
+PartialEquilibriumCheckpoint
+PartialEquilibrium::save_state(void) const
+{
+	return PartialEquilibriumCheckpoint{ .num_yields  = m_stable.size(),
+		                                 .initialized = 0,
+		                                 .temperature = m_temperature,
+		                                 .volume      = m_volume };
+}
+
+YieldCheckpoint
+PartialEquilibrium::save_yield(std::size_t i) const
+{
+	return YieldCheckpoint{ .pid              = m_stable[i]->get_pid(),
+		                    .effective_number = m_effective_numbers[i],
+		                    .log_fugacity     = m_log_fugacity[i] };
+}
+
+/// @brief Restores the state written by `save_state` and `save_yield`, which continues the evolution bit-for-bit
+void
+PartialEquilibrium::load_state(PartialEquilibriumCheckpoint const& state, std::vector<YieldCheckpoint> const& yields)
+{
+	assert(yields.size() == m_stable.size() && "Checkpoint does not match the stable particles");
+	m_temperature = state.temperature;
+	m_volume      = state.volume;
+	for (std::size_t i{ 0 }; i < m_stable.size(); ++i)
+	{
+		assert(yields[i].pid == m_stable[i]->get_pid() && "Checkpoint does not match the stable particles");
+		m_effective_numbers[i] = yields[i].effective_number;
+		m_log_fugacity[i]      = yields[i].log_fugacity;
+	}
+	m_eq_temperature = std::numeric_limits<double>::quiet_NaN();
+}
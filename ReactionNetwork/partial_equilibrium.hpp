@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "particle.hpp"
+#include "profile_source.hpp"
+#include "reaction_info.hpp"
+
+/// @brief Evolves the effective yields of the stable hadrons, assuming partial chemical equilibrium
+/// @details After chemical freeze-out the resonances stay in relative chemical equilibrium with their daughters, so
+/// only the effective densities of the stable hadrons,
+///     nbar_i = n_i + sum_R <N_i>_R n_R,
+/// evolve. Here <N_i>_R is the average number of stable hadrons i produced in the full decay chain of R, built once
+/// from the branching ratios stored in the `ReactionInfo`s of each particle. Decays conserve the effective yields, so
+/// only the expansion and the scattering reactions that change them enter the evolution. The densities of all species
+/// follow from the species-dependent chemical potentials mu_i of the stable hadrons,
+///     n_i = n_i,eq e^{mu_i / T},    n_R = n_R,eq e^{sum_i <N_i>_R mu_i / T},
+/// which are solved for with Newton's method whenever the densities are needed. A particle counts as stable if its
+/// decay width vanishes or it has no decay channels.
+class PartialEquilibrium
+{
+	public:
+	PartialEquilibrium() = default;
+	PartialEquilibrium(std::unordered_map<long, std::shared_ptr<Particle>> const& particles);
+
+	void initialize(double temperature, double volume);
+	void time_step(double tau, double dt, ProfileSource& profile);
+	void rebuild_densities(void);
+
+	std::size_t num_yields(void) const { return m_stable.size(); }
+
+	std::vector<std::shared_ptr<Particle>> const& get_stable_particles(void) const { return m_stable; }
+
+	double get_effective_density(std::size_t i) const { return m_effective_numbers[i] / m_volume; }
+
+	PartialEquilibriumCheckpoint save_state(void) const;
+	YieldCheckpoint              save_yield(std::size_t i) const;
+	void load_state(PartialEquilibriumCheckpoint const& state, std::vector<YieldCheckpoint> const& yields);
+
+	private:
+	/// @brief A scattering reaction, together with the change in effective yields when the reactants gain one unit
+	struct YieldChangingReaction {
+		std::shared_ptr<Particle> owner;
+		ReactionInfo const*       reaction;
+		std::vector<double>       change;
+	};
+
+	void                update_eq_densities(double temperature);
+	void                solve_chemical_potentials(
+	    double                     temperature,
+	    std::vector<double> const& effective_densities,
+	    std::vector<double>&       log_fugacity
+	);
+	void                set_stage_densities(double temperature, std::vector<double> const& log_fugacity);
+	std::vector<double> yield_rates(double tau, std::vector<double> const& effective_numbers, ProfileSource& profile);
+
+	std::vector<std::shared_ptr<Particle>> m_stable;
+	std::vector<std::shared_ptr<Particle>> m_resonances;
+	std::vector<std::vector<double>>       m_multiplicity;    // <N_i>_R, one row per resonance
+	std::vector<YieldChangingReaction>     m_reactions;
+
+	std::vector<double> m_effective_numbers;    // nbar_i V
+	std::vector<double> m_log_fugacity;         // mu_i / T, kept as the starting point for the next solve
+	double              m_temperature{ 0.0 };    // Temperature at the end of the last step
+	double              m_volume{ 1.0 };         // Volume at the end of the last step
+	double              m_eq_temperature{ std::numeric_limits<double>::quiet_NaN() };    // Of the cached n_eq
+};
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "particle.hpp"
 
+#include <array>
+
 Particle::Particle(
-    long        pid,
-    double      mass,
-    double      degeneracy,
-    double      decay_width,
-    SpinStat    spin_stat,
-    std::size_t decay_channels
+    long             pid,
+    double           mass,
+    double           degeneracy,
+    double           decay_width,
+    SpinStat         spin_stat,
+    std::size_t      decay_channels,
+    ConservedCharges charges
 )
 {
 	m_pid         = pid;
@@ -14,18 +17,34 @@ Particle::Particle(
 	m_degeneracy  = degeneracy;
 	m_decay_width = decay_width;
 	m_spin_stat   = spin_stat;
+	m_charges     = charges;
 	m_density     = 0.0;
+	m_eq_density  = 0.0;
 	m_reaction_infos.reserve(decay_channels);
 }
 
 void
 Particle::finalize_time_step(void)
 {
-	m_density += (k1 + 2.0 * k2 + 2.0 * k3 + k4) / 6.0;
+	m_density += get_RK4_increment();
+	reset_stages();
+}
+
+void
+Particle::reset_stages(void)
+{
 	k1 = k2 = k3 = k4       = 0.0;
 	m_eq_density_calculated = false;
 }
 
+double
+Particle::get_RK4_increment(void)
+{
+	return (k1 + 2.0 * k2 + 2.0 * k3 + k4) / 6.0;
+}
+
+/// @details Every stage stores k_s = dt f(stage state), the half steps enter only through the stage offsets
+/// (0, k1/2, k2/2, k3), so that (k1 + 2 k2 + 2 k3 + k4) / 6 is the classical RK4 increment
 void
 Particle::update(double delta_density, double dt, RK4Stage stage)
 {
@@ -38,12 +57,12 @@ Particle::update(double delta_density, double dt, RK4Stage stage)
 		}
 		case RK4Stage::SECOND :
 		{
-			k2 += 0.5 * dt * delta_density;
+			k2 += dt * delta_density;
 			break;
 		}
 		case RK4Stage::THIRD :
 		{
-			k3 += 0.5 * dt * delta_density;
+			k3 += dt * delta_density;
 			break;
 		}
 		case RK4Stage::FOURTH :
@@ -54,55 +73,60 @@ Particle::update(double delta_density, double dt, RK4Stage stage)
 	}
 }
 
+/// @brief Quadrature nodes and weights on [0, 1], scaled to [0, q_max] for each temperature
+static auto const eq_density_rule = composite_gauss_legendre<eq_density_panels>();
+
+/// @brief Equilibrium density at `temperature`, cached until `invalidate_eq_density` or the end of the time step
 double
 Particle::get_eq_density(double temperature)
 {
 	if (m_eq_density_calculated) return m_eq_density;
 
-	m_eq_density = gauss_quad(
-	    [&](double q) -> double
-	    {
-		    double energy{ 0.0 };
-		    if (std::fabs(temperature / m_mass) < 1e-2) energy = q * q / (2.0 * m_mass);
-		    else energy = std::sqrt(q * q + m_mass * m_mass);
-
-		    double f{ 0.0 };
-		    switch (m_spin_stat)
-		    {
-			    case SpinStat::MB :
-			    {
-				    double thermal_wavelength{ std::sqrt(2.0 * pi / (m_mass * temperature)) };
-				    double norm{ 1.0 };
-				    for (auto i{ 0 }; i < 3; ++i)
-					    norm *= thermal_wavelength;
-				    f = std::exp(energy / temperature) / norm;
-				    break;
-			    }
-			    case SpinStat::FD :
-			    {
-				    f = 1.0 / (std::exp(energy / temperature) + 1.0);
-				    break;
-			    }
-			    case SpinStat::BE :
-			    {
-				    f = 1.0 / (std::exp(energy / temperature) - 1.0);
-				    break;
-			    }
-		    }
-
-		    // Return density in units fm^{-3}
-		    return m_degeneracy * f / (2.0 * pi * pi) / (hbar * hbar * hbar);
-	    },
-	    0.0,
-	    inf,
-	    1e-10,
-	    3
-	);
-
+	m_eq_density            = calculate_eq_density(temperature);
 	m_eq_density_calculated = true;
 	return m_eq_density;
 }
 
+/// @details n_eq = g / (2 pi^2 hbar^3) int_0^infty dq q^2 f(E_q). The integrand is evaluated on all quadrature nodes
+/// at once with the batched kernels from `thermal_kernels.hpp`, and the momentum integral is cut off where E - m = 50 T
+/// (the occupation number is below 2 10^-22 there). Does not touch the cached value, so it can be used for states
+/// that are stored outside of the particle
+double
+Particle::calculate_eq_density(double temperature) const
+{
+	double energy_max{ m_mass + 50.0 * temperature };
+	double q_max{ std::sqrt(energy_max * energy_max - m_mass * m_mass) };
+
+	auto const& [nodes, weights] = eq_density_rule;
+	std::array<double, eq_density_points> q;
+	std::array<double, eq_density_points> energy;
+	std::array<double, eq_density_points> f;
+	for (std::size_t i{ 0 }; i < eq_density_points; ++i)
+		q[i] = q_max * nodes[i];
+	batch_energy(q, m_mass, energy);
+
+	switch (m_spin_stat)
+	{
+		case SpinStat::MB :
+			batch_occupation<SpinStat::MB>(energy, 1.0 / temperature, f);
+			break;
+		case SpinStat::FD :
+			batch_occupation<SpinStat::FD>(energy, 1.0 / temperature, f);
+			break;
+		case SpinStat::BE :
+			batch_occupation<SpinStat::BE>(energy, 1.0 / temperature, f);
+			break;
+	}
+
+	double integral{ 0.0 };
+	for (std::size_t i{ 0 }; i < eq_density_points; ++i)
+		integral += weights[i] * q[i] * q[i] * f[i];
+	integral *= q_max;
+
+	// Return density in units fm^{-3}
+	return m_degeneracy * integral / (2.0 * pi * pi) / (hbar * hbar * hbar);
+}
+
 double
 Particle::get_RK4Stage_offset(RK4Stage stage)
 {
@@ -123,4 +147,30 @@ void
 Particle::add_reaction(ReactionInfo&& info)
 {
 	m_reaction_infos.push_back(std::move(info));
+}
+
+ParticleCheckpoint
+Particle::save_state(void) const
+{
+	return ParticleCheckpoint{ .pid                   = m_pid,
+		                       .density               = m_density,
+		                       .eq_density            = m_eq_density,
+		                       .k1                    = k1,
+		                       .k2                    = k2,
+		                       .k3                    = k3,
+		                       .k4                    = k4,
+		                       .eq_density_calculated = m_eq_density_calculated };
+}
+
+void
+Particle::load_state(ParticleCheckpoint const& state)
+{
+	assert(state.pid == m_pid && "Checkpoint entry belongs to a different particle");
+	m_density               = state.density;
+	m_eq_density            = state.eq_density;
+	k1                      = state.k1;
+	k2                      = state.k2;
+	k3                      = state.k3;
+	k4                      = state.k4;
+	m_eq_density_calculated = state.eq_density_calculated != 0;
 }
\ No newline at end of file
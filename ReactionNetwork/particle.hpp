@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <cstddef>
 #include <cstdio>
 #include <limits>
@@ -10,11 +11,18 @@
 #include "../constants.hpp"
 #include "../integration.hpp"
 
+#include "checkpoint.hpp"
+#include "conserved_charges.hpp"
 #include "print.hpp"
 #include "reaction_info.hpp"
 #include "reaction_type.hpp"
 #include "rk4_stages.hpp"
 #include "spin_statistics.hpp"
+#include "thermal_kernels.hpp"
+
+// Quadrature used for the equilibrium densities
+constexpr std::size_t eq_density_panels = 4;
+constexpr std::size_t eq_density_points = eq_density_panels * 2 * NSUM48;
 
 /// @brief Stores the particle ID and reactions, and facilitates density updates
 /// @details Stores the particle ID, (for now, only the) decay width, and list of daughters with the corresponding
@@ -30,12 +38,13 @@ class Particle
 	Particle() = default;
 
 	Particle(
-	    long        pid,
-	    double      mass,
-	    double      degeneracy,
-	    double      decay_width,
-	    SpinStat    spin_stat,
-	    std::size_t decay_channels
+	    long             pid,
+	    double           mass,
+	    double           degeneracy,
+	    double           decay_width,
+	    SpinStat         spin_stat,
+	    std::size_t      decay_channels,
+	    ConservedCharges charges = {}
 	);
 
 	double get_density(void) { return m_density; }
@@ -44,12 +53,41 @@ class Particle
 
 	int get_pid(void) { return m_pid; }
 
+	double get_mass(void) { return m_mass; }
+
+	double get_degeneracy(void) { return m_degeneracy; }
+
+	double get_decay_width(void) { return m_decay_width; }
+
+	ConservedCharges get_charges(void) const { return m_charges; }
+
+	void invalidate_eq_density(void) { m_eq_density_calculated = false; }
+
+	double get_stage_density(void) { return m_stage_density; }
+
+	void set_stage_density(double stage_density) { m_stage_density = stage_density; }
+
+	void add_rate(double rate) { m_rate += rate; }
+
+	double take_rate(void)
+	{
+		double rate{ m_rate };
+		m_rate = 0.0;
+		return rate;
+	}
+
 	void   update(double delta_density, double dt, RK4Stage stage);
 	void   finalize_time_step(void);
+	void   reset_stages(void);
+	double get_RK4_increment(void);
 	double get_eq_density(double temperature);
+	double calculate_eq_density(double temperature) const;
 	double get_RK4Stage_offset(RK4Stage stage);
 	void   add_reaction(ReactionInfo&& info);
 
+	ParticleCheckpoint save_state(void) const;
+	void               load_state(ParticleCheckpoint const& state);
+
 	std::vector<ReactionInfo> const& get_reactions(void) const { return m_reaction_infos; }
 
 	public:
@@ -68,6 +106,11 @@ class Particle
 	double                    m_mass;
 	double                    m_decay_width;
 	double                    m_degeneracy;
+	ConservedCharges          m_charges;
 	std::vector<ReactionInfo> m_reaction_infos;
 	bool                      m_eq_density_calculated{ false };
+
+	// For evolution of density ratios
+	double m_stage_density{ 0.0 };    // Density at the current RK4 stage
+	double m_rate{ 0.0 };             // Net rate dn/dt accumulated over all reactions at the current RK4 stage
 };
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "profile_source.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+/// @brief Linear interpolation between two consecutive records
+static ProfileRecord
+interpolate(ProfileBracket const& bracket, double tau)
+{
+	auto const& [lower, upper] = bracket;
+	if (upper.tau == lower.tau) return lower;
+	double w{ (tau - lower.tau) / (upper.tau - lower.tau) };
+	return ProfileRecord{ .tau         = tau,
+		                  .temperature = (1.0 - w) * lower.temperature + w * upper.temperature,
+		                  .volume      = (1.0 - w) * lower.volume + w * upper.volume };
+}
+
+/// @brief d ln(V) / d tau of the linearly interpolated volume
+static double
+slope_expansion_rate(ProfileBracket const& bracket, double tau)
+{
+	auto const& [lower, upper] = bracket;
+	if (upper.tau == lower.tau) return 0.0;
+	double dV_dtau{ (upper.volume - lower.volume) / (upper.tau - lower.tau) };
+	return dV_dtau / interpolate(bracket, tau).volume;
+}
+
+AnalyticProfile::AnalyticProfile(std::function<double(double)> temperature, std::function<double(double)> volume)
+    : m_temperature(std::move(temperature))
+    , m_volume(std::move(volume))
+{
+}
+
+/// @brief Central finite difference of ln(V)
+double
+AnalyticProfile::expansion_rate(double tau)
+{
+	double h{ 1e-6 * std::max(std::fabs(tau), 1.0) };
+	return (std::log(m_volume(tau + h)) - std::log(m_volume(tau - h))) / (2.0 * h);
+}
+
+// -------------------------------------------------------------------------------------------------------------------
+
+/// @brief Opens a tabulated background
+/// @param profile_file path to text file with columns `tau temperature volume`, sorted by `tau`. Empty lines and
+/// lines starting with `#` are skipped
+/// @param chunk_size number of rows to read each time the requested time passes the loaded rows
+/// @details Function can fail due to file not existing, and will terminate program
+TabulatedProfile::TabulatedProfile(std::string_view profile_file, std::size_t chunk_size)
+    : m_fin(profile_file.data(), std::fstream::in)
+    , m_chunk_size(chunk_size)
+{
+	assert(m_fin.is_open() && "Profile file failed to open");
+	assert(m_chunk_size > 0 && "Profile chunk size has to be positive");
+}
+
+bool
+TabulatedProfile::read_chunk(void)
+{
+	std::string line;
+	std::size_t rows_read{ 0 };
+	while (rows_read < m_chunk_size && std::getline(m_fin, line))
+	{
+		auto entries{ split_string(line) };
+		if (entries.empty() || entries[0][0] == '#') continue;
+		assert(entries.size() >= 3 && "Profile file needs columns: tau temperature volume");
+
+		ProfileRecord record{ .tau         = std::stod(entries[0]),
+			                  .temperature = std::stod(entries[1]),
+			                  .volume      = std::stod(entries[2]) };
+		assert((m_window.empty() || record.tau >= m_window.back().tau) && "Profile file must be sorted in tau");
+		m_window.push_back(record);
+		++rows_read;
+	}
+	return rows_read > 0;
+}
+
+ProfileBracket
+TabulatedProfile::bracket(double tau)
+{
+	while (m_window.size() < 2 || m_window.back().tau < tau)
+	{
+		[[maybe_unused]] bool more_rows = read_chunk();
+		assert(more_rows && "Requested time lies past the end of the profile file");
+	}
+
+	// Rows before the bracketing pair are not needed anymore, since requested times do not decrease
+	while (m_window.size() > 2 && m_window[1].tau <= tau)
+		m_window.pop_front();
+	assert(m_window.front().tau <= tau && "Requested time lies before the start of the profile file");
+
+	return ProfileBracket{ .lower = m_window[0], .upper = m_window[1] };
+}
+
+double
+TabulatedProfile::temperature(double tau)
+{
+	return interpolate(bracket(tau), tau).temperature;
+}
+
+double
+TabulatedProfile::volume(double tau)
+{
+	return interpolate(bracket(tau), tau).volume;
+}
+
+double
+TabulatedProfile::expansion_rate(double tau)
+{
+	return slope_expansion_rate(bracket(tau), tau);
+}
+
+// -------------------------------------------------------------------------------------------------------------------
+
+/// @brief Maps the shared-memory segment `name`, which has to be created by the producer beforehand
+/// @details Function can fail if the segment does not exist, and will terminate program
+SharedMemoryProfile::SharedMemoryProfile(std::string_view name)
+{
+	int fd{ shm_open(std::string(name).c_str(), O_RDWR, 0600) };
+	assert(fd != -1 && "Shared-memory profile does not exist");
+	void* address{ mmap(nullptr, sizeof(ProfileRingBuffer), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+	close(fd);
+	assert(address != MAP_FAILED && "Failed to map shared-memory profile");
+	m_ring = static_cast<ProfileRingBuffer*>(address);
+}
+
+SharedMemoryProfile::~SharedMemoryProfile()
+{
+	munmap(m_ring, sizeof(ProfileRingBuffer));
+}
+
+ProfileBracket
+SharedMemoryProfile::bracket(double tau)
+{
+	auto tail{ m_ring->tail.load(std::memory_order_relaxed) };
+	auto head{ m_ring->head.load(std::memory_order_acquire) };
+	auto at = [this](std::uint64_t n) -> ProfileRecord const& { return m_ring->records[n % profile_ring_capacity]; };
+
+	// Wait for the producer to reach the requested time
+	while (head - tail < 2 || at(head - 1).tau < tau)
+	{
+		if (m_ring->finished.load(std::memory_order_acquire))
+		{
+			head = m_ring->head.load(std::memory_order_acquire);
+			assert((head - tail >= 2 && at(head - 1).tau >= tau) && "Requested time lies past the end of the stream");
+			break;
+		}
+		std::this_thread::yield();
+		head = m_ring->head.load(std::memory_order_acquire);
+	}
+
+	// Release records before the bracketing pair to the producer
+	while (head - tail > 2 && at(tail + 1).tau <= tau)
+		++tail;
+	m_ring->tail.store(tail, std::memory_order_release);
+	assert(at(tail).tau <= tau && "Requested time lies before the start of the stream");
+
+	return ProfileBracket{ .lower = at(tail), .upper = at(tail + 1) };
+}
+
+double
+SharedMemoryProfile::temperature(double tau)
+{
+	return interpolate(bracket(tau), tau).temperature;
+}
+
+double
+SharedMemoryProfile::volume(double tau)
+{
+	return interpolate(bracket(tau), tau).volume;
+}
+
+double
+SharedMemoryProfile::expansion_rate(double tau)
+{
+	return slope_expansion_rate(bracket(tau), tau);
+}
+
+// -------------------------------------------------------------------------------------------------------------------
+
+/// @brief Creates and maps the shared-memory segment `name`, replacing any stale segment of the same name
+/// @details Function can fail if the segment cannot be created, and will terminate program
+SharedMemoryProfileProducer::SharedMemoryProfileProducer(std::string_view name)
+    : m_name(name)
+{
+	shm_unlink(m_name.c_str());
+	int fd{ shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) };
+	assert(fd != -1 && "Failed to create shared-memory profile");
+	[[maybe_unused]] int err{ ftruncate(fd, sizeof(ProfileRingBuffer)) };
+	assert(err == 0 && "Failed to size shared-memory profile");
+	void* address{ mmap(nullptr, sizeof(ProfileRingBuffer), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) };
+	close(fd);
+	assert(address != MAP_FAILED && "Failed to map shared-memory profile");
+	m_ring = new (address) ProfileRingBuffer{};
+}
+
+SharedMemoryProfileProducer::~SharedMemoryProfileProducer()
+{
+	munmap(m_ring, sizeof(ProfileRingBuffer));
+	shm_unlink(m_name.c_str());
+}
+
+/// @brief Appends a record, waiting for the consumer if the ring buffer is full
+void
+SharedMemoryProfileProducer::push(ProfileRecord const& record)
+{
+	auto head{ m_ring->head.load(std::memory_order_relaxed) };
+	while (head - m_ring->tail.load(std::memory_order_acquire) >= profile_ring_capacity)
+		std::this_thread::yield();
+	m_ring->records[head % profile_ring_capacity] = record;
+	m_ring->head.store(head + 1, std::memory_order_release);
+}
+
+/// @brief Signals the consumer that no further records will be pushed
+void
+SharedMemoryProfileProducer::finish(void)
+{
+	m_ring->finished.store(1, std::memory_order_release);
+}
+
+/// @brief Samples `source` on the interval [tau_0, tau_f] with spacing `dtau`, pushes the samples and finishes
+void
+SharedMemoryProfileProducer::stream(ProfileSource& source, double tau_0, double tau_f, double dtau)
+{
+	std::size_t num_samples{ static_cast<std::size_t>(std::ceil((tau_f - tau_0) / dtau)) + 1 };
+	for (std::size_t n{ 0 }; n < num_samples; ++n)
+	{
+		double tau{ tau_0 + n * dtau };
+		push(ProfileRecord{ .tau = tau, .temperature = source.temperature(tau), .volume = source.volume(tau) });
+	}
+	finish();
+}
\ No newline at end of file
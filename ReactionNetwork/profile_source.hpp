@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "string_utility.hpp"
+
+/// @brief Interface for the background that drives the reaction network
+/// @details The reaction network does not evolve the background itself, it only needs to know the temperature and
+/// volume at the times requested by the Runge-Kutta stages. Implementations may assume that the requested times are
+/// non-decreasing from one time step to the next, but within a time step the same time may be requested more than
+/// once.
+class ProfileSource
+{
+	public:
+	virtual ~ProfileSource() = default;
+
+	virtual double temperature(double tau)    = 0;
+	virtual double volume(double tau)         = 0;
+	virtual double expansion_rate(double tau) = 0;    // d ln(V) / d tau
+};
+
+/// @brief Background given by closed-form expressions for the temperature and volume
+class AnalyticProfile : public ProfileSource
+{
+	public:
+	AnalyticProfile(std::function<double(double)> temperature, std::function<double(double)> volume);
+
+	double temperature(double tau) override { return m_temperature(tau); }
+
+	double volume(double tau) override { return m_volume(tau); }
+
+	double expansion_rate(double tau) override;
+
+	private:
+	std::function<double(double)> m_temperature;
+	std::function<double(double)> m_volume;
+};
+
+/// @brief One entry of a tabulated or streamed background
+struct ProfileRecord {
+	double tau;
+	double temperature;
+	double volume;
+};
+
+/// @brief Pair of consecutive records with `lower.tau <= tau <= upper.tau`
+struct ProfileBracket {
+	ProfileRecord lower;
+	ProfileRecord upper;
+};
+
+/// @brief Background read from a text file with columns `tau temperature volume`
+/// @details The file is read lazily, `chunk_size` lines at a time, as the requested time advances past the rows that
+/// have already been loaded. Rows that lie entirely before the last requested time are dropped, so only a small window
+/// of the file is kept in memory. Values in between rows are linearly interpolated, and the expansion rate is taken
+/// from the slope of the volume between the two rows.
+class TabulatedProfile : public ProfileSource
+{
+	public:
+	TabulatedProfile(std::string_view profile_file, std::size_t chunk_size = 1024);
+
+	double temperature(double tau) override;
+	double volume(double tau) override;
+	double expansion_rate(double tau) override;
+
+	private:
+	ProfileBracket bracket(double tau);
+	bool           read_chunk(void);
+
+	std::fstream              m_fin;
+	std::size_t               m_chunk_size;
+	std::deque<ProfileRecord> m_window;
+};
+
+/// @brief Number of records stored in the shared-memory ring buffer
+constexpr std::size_t profile_ring_capacity = 4096;
+
+/// @brief Layout of the shared-memory segment connecting an external hydro process to the reaction network
+/// @details The producer appends records at `head` and only overwrites a slot once the consumer has moved `tail` past
+/// it. The consumer keeps `tail` at the oldest record it may still interpolate from. Both counters increase
+/// monotonically; the slot of record `n` is `n % profile_ring_capacity`.
+struct ProfileRingBuffer {
+	std::atomic<std::uint64_t> head;        // Number of records written by the producer
+	std::atomic<std::uint64_t> tail;        // Oldest record still needed by the consumer
+	std::atomic<std::uint64_t> finished;    // Set by the producer after the last record
+	ProfileRecord              records[profile_ring_capacity];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Ring buffer counters must be usable across processes");
+
+/// @brief Background streamed through a POSIX shared-memory ring buffer by a separate process
+/// @details Requests for a time that the producer has not reached yet wait for the producer. Requesting a time past
+/// the last record after the producer has finished is an error and terminates the program.
+class SharedMemoryProfile : public ProfileSource
+{
+	public:
+	SharedMemoryProfile(std::string_view name);
+	~SharedMemoryProfile();
+
+	SharedMemoryProfile(SharedMemoryProfile const&)            = delete;
+	SharedMemoryProfile& operator=(SharedMemoryProfile const&) = delete;
+
+	double temperature(double tau) override;
+	double volume(double tau) override;
+	double expansion_rate(double tau) override;
+
+	private:
+	ProfileBracket bracket(double tau);
+
+	ProfileRingBuffer* m_ring;
+};
+
+/// @brief Writing end of the shared-memory ring buffer
+/// @details Creates the shared-memory segment on construction and removes it on destruction. Stands in for the
+/// external hydro process when running locally: `stream` samples another `ProfileSource` and pushes the samples into
+/// the ring buffer, and can be run on a separate thread or in a forked process.
+class SharedMemoryProfileProducer
+{
+	public:
+	SharedMemoryProfileProducer(std::string_view name);
+	~SharedMemoryProfileProducer();
+
+	SharedMemoryProfileProducer(SharedMemoryProfileProducer const&)            = delete;
+	SharedMemoryProfileProducer& operator=(SharedMemoryProfileProducer const&) = delete;
+
+	void push(ProfileRecord const& record);
+	void finish(void);
+	void stream(ProfileSource& source, double tau_0, double tau_f, double dtau);
+
+	private:
+	std::string        m_name;
+	ProfileRingBuffer* m_ring;
+};
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "rate_table.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "../constants.hpp"
+#include "../integration.hpp"
+
+#include "thermal_kernels.hpp"
+
+constexpr std::size_t bessel_panels      = 4;
+constexpr std::size_t bessel_points      = 2 * NSUM48 * bessel_panels;
+constexpr double      bessel_v_max       = 7.5;    // e^{-v_max^2} is below 10^-24
+constexpr double      mb_to_fm2          = 0.1;
+constexpr char        rate_table_magic[] = "RXR8RTB";
+
+// Bump whenever the thermal average or the cache layout changes, so stale cache files are not picked up
+constexpr std::uint64_t rate_table_version = 2;
+
+/// @brief Quadrature on v in [0, v_max] for `bessel_k1_scaled`, with the factors 2 e^{-v^2} folded into the weights
+static auto const bessel_rule = []
+{
+	auto rule{ composite_gauss_legendre<bessel_panels>() };
+	auto& [nodes, weights] = rule;
+
+	std::array<double, bessel_points> minus_v2;
+	std::array<double, bessel_points> gaussian;
+	for (std::size_t i{ 0 }; i < bessel_points; ++i)
+	{
+		nodes[i] *= bessel_v_max;
+		minus_v2[i] = -nodes[i] * nodes[i];
+	}
+	batch_exp(minus_v2, gaussian);
+	for (std::size_t i{ 0 }; i < bessel_points; ++i)
+		weights[i] *= 2.0 * bessel_v_max * gaussian[i];
+	return rule;
+}();
+
+/// @details Starting from K_1(z) = int_0^infty dt e^{-z cosh(t)} cosh(t) and substituting z (cosh(t) - 1) = v^2 gives
+/// e^z K_1(z) = int_0^infty dv 2 e^{-v^2} (1 + v^2 / z) / sqrt(v^2 + 2 z), whose integrand is smooth for z > 0. The
+/// Gaussian factor is precomputed, so each call only needs one batch of square roots. Relative error is below 10^-12
+/// for z >= 0.1.
+double
+bessel_k1_scaled(double z)
+{
+	auto const& [nodes, weights] = bessel_rule;
+
+	std::array<double, bessel_points> radicand;
+	std::array<double, bessel_points> root;
+	for (std::size_t i{ 0 }; i < bessel_points; ++i)
+		radicand[i] = nodes[i] * nodes[i] + 2.0 * z;
+	batch_sqrt(radicand, root);
+
+	double result{ 0.0 };
+	for (std::size_t i{ 0 }; i < bessel_points; ++i)
+		result += weights[i] * (1.0 + nodes[i] * nodes[i] / z) / root[i];
+	return result;
+}
+
+/// @details Integrates over x = sqrt(s) from threshold x_0 = m_1 + m_2 up to x_0 + 60 T. The factor e^{-x_0 / T} of
+/// the Bessel function is pulled out of the integral and added to the logarithm, so the result does not underflow
+/// for heavy channels at low temperature.
+double
+log_equilibrium_rate(TwoBodyChannel const& channel, double temperature)
+{
+	double m1{ channel.mass_1 };
+	double m2{ channel.mass_2 };
+	double threshold{ m1 + m2 };
+
+	double integral = gauss_quad(
+	    [&](double x) -> double
+	    {
+		    double s{ x * x };
+		    double p_cm2{ (s - (m1 + m2) * (m1 + m2)) * (s - (m1 - m2) * (m1 - m2)) / (4.0 * s) };
+		    double boltzmann{ exp_kernel(-(x - threshold) / temperature) };
+		    return 2.0 * s * channel.cross_section(x) * p_cm2 * boltzmann * bessel_k1_scaled(x / temperature);
+	    },
+	    threshold,
+	    threshold + 60.0 * temperature,
+	    1e-9,
+	    8
+	);
+
+	// Convert GeV^6 to fm^-6 and mb to fm^2, giving C in fm^-4
+	double hbar6{ std::pow(hbar, 6) };
+	double prefactor{ channel.degeneracy_1 * channel.degeneracy_2 * temperature / (8.0 * std::pow(pi, 4) * hbar6) };
+	return std::log(prefactor * mb_to_fm2 * integral) - threshold / temperature;
+}
+
+/// @brief FNV-1a hash of everything that determines the contents of a rate table
+static std::uint64_t
+hash_rate_table(TwoBodyChannel const& channel, RateTableGrid const& grid)
+{
+	std::uint64_t hash{ 14695981039346656037ull };
+	auto          add = [&hash](auto const& value)
+	{
+		unsigned char bytes[sizeof(value)];
+		std::memcpy(bytes, &value, sizeof(value));
+		for (auto byte : bytes)
+		{
+			hash ^= byte;
+			hash *= 1099511628211ull;
+		}
+	};
+
+	add(rate_table_version);
+	add(channel.mass_1);
+	add(channel.mass_2);
+	add(channel.degeneracy_1);
+	add(channel.degeneracy_2);
+	add(static_cast<int>(channel.cross_section.model));
+	for (auto parameter : channel.cross_section.parameters)
+		add(parameter);
+	add(grid.temperature_min);
+	add(grid.temperature_max);
+	add(grid.initial_points);
+	add(grid.tolerance);
+	add(grid.max_depth);
+	return hash;
+}
+
+/// @brief Loads the table for `channel` from `cache_dir`, or builds it and stores it there
+/// @param cache_dir directory for cached tables; created if missing. Pass an empty string to disable caching
+RateTable::RateTable(TwoBodyChannel const& channel, RateTableGrid const& grid, std::string_view cache_dir)
+    : m_threshold(channel.mass_1 + channel.mass_2)
+{
+	assert(grid.temperature_min > 0.0 && grid.temperature_max > grid.temperature_min && "Invalid temperature range");
+	assert(grid.initial_points >= 2 && "Rate table needs at least two initial points");
+
+	auto log_function = [&channel](double temperature) { return log_equilibrium_rate(channel, temperature); };
+	if (cache_dir.empty())
+	{
+		build(log_function, grid);
+		return;
+	}
+
+	auto              hash{ hash_rate_table(channel, grid) };
+	std::stringstream name;
+	name << "rate_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	std::filesystem::create_directories(cache_dir);
+	auto cache_file{ (std::filesystem::path{ cache_dir } / name.str()).string() };
+
+	if (read_cache(cache_file, hash)) return;
+	build(log_function, grid);
+	write_cache(cache_file, hash);
+}
+
+/// @brief Tabulates ln(f(T)) + threshold / T for an arbitrary positive function f
+/// @param log_function returns ln(f(T)), which has to be finite on the whole grid
+/// @param threshold energy scale of the Boltzmann suppression of f, such as the mass for an equilibrium density
+RateTable::RateTable(LogFunction const& log_function, double threshold, RateTableGrid const& grid)
+    : m_threshold(threshold)
+{
+	assert(grid.temperature_min > 0.0 && grid.temperature_max > grid.temperature_min && "Invalid temperature range");
+	assert(grid.initial_points >= 2 && "Rate table needs at least two initial points");
+	build(log_function, grid);
+}
+
+/// @brief Linear interpolation of the tabulated values in ln(T)
+/// @details Outside of the table the first or last interval is extrapolated linearly in ln(T). Far from threshold
+/// ln(C) + (m_1 + m_2) / T approaches a power law in T, so this keeps the rate finite and physically sensible when the
+/// medium cools below `RateTableGrid::temperature_min` (or heats above `temperature_max`), with an accuracy that
+/// decreases with the distance from the table. Returns ln(C), which stays finite where C itself underflows
+double
+RateTable::log_value(double temperature) const
+{
+	double log_T{ std::log(temperature) };
+
+	// For temperatures outside the table these select the first and last interval, with w < 0 or w > 1
+	auto upper{ std::upper_bound(m_log_temperature.begin(), m_log_temperature.end() - 1, log_T) };
+	auto i{ static_cast<std::size_t>(std::distance(m_log_temperature.begin(), upper)) };
+	i = std::max<std::size_t>(i, 1);
+
+	double w{ (log_T - m_log_temperature[i - 1]) / (m_log_temperature[i] - m_log_temperature[i - 1]) };
+	return (1.0 - w) * m_log_rate[i - 1] + w * m_log_rate[i] - m_threshold / temperature;
+}
+
+double
+RateTable::tabulated_value(LogFunction const& log_function, double log_T) const
+{
+	double temperature{ std::exp(log_T) };
+	double value{ log_function(temperature) + m_threshold / temperature };
+	assert(std::isfinite(value) && "Tabulated function has to be positive and finite on the grid");
+	return value;
+}
+
+void
+RateTable::build(LogFunction const& log_function, RateTableGrid const& grid)
+{
+	m_log_temperature.clear();
+	m_log_rate.clear();
+
+	double log_T_min{ std::log(grid.temperature_min) };
+	double log_T_max{ std::log(grid.temperature_max) };
+	double spacing{ (log_T_max - log_T_min) / (grid.initial_points - 1) };
+
+	double log_T{ log_T_min };
+	double log_C{ tabulated_value(log_function, log_T) };
+	m_log_temperature.push_back(log_T);
+	m_log_rate.push_back(log_C);
+	for (std::size_t n{ 1 }; n < grid.initial_points; ++n)
+	{
+		double next_log_T{ n + 1 == grid.initial_points ? log_T_max : log_T_min + n * spacing };
+		double next_log_C{ tabulated_value(log_function, next_log_T) };
+		refine(log_function, grid, log_T, log_C, next_log_T, next_log_C, 0);
+		m_log_temperature.push_back(next_log_T);
+		m_log_rate.push_back(next_log_C);
+		log_T = next_log_T;
+		log_C = next_log_C;
+	}
+}
+
+/// @brief Inserts the points needed between the two given points, in ascending order
+void
+RateTable::refine(
+    LogFunction const&   log_function,
+    RateTableGrid const& grid,
+    double               log_T_lower,
+    double               log_C_lower,
+    double               log_T_upper,
+    double               log_C_upper,
+    int                  depth
+)
+{
+	if (depth >= grid.max_depth) return;
+
+	double log_T_middle{ 0.5 * (log_T_lower + log_T_upper) };
+	double log_C_middle{ tabulated_value(log_function, log_T_middle) };
+	if (std::fabs(log_C_middle - 0.5 * (log_C_lower + log_C_upper)) < grid.tolerance) return;
+
+	refine(log_function, grid, log_T_lower, log_C_lower, log_T_middle, log_C_middle, depth + 1);
+	m_log_temperature.push_back(log_T_middle);
+	m_log_rate.push_back(log_C_middle);
+	refine(log_function, grid, log_T_middle, log_C_middle, log_T_upper, log_C_upper, depth + 1);
+}
+
+bool
+RateTable::read_cache(std::string_view cache_file, std::uint64_t hash)
+{
+	std::ifstream fin(std::filesystem::path{ cache_file }, std::ios::in | std::ios::binary);
+	if (!fin.is_open()) return false;
+
+	char          magic[sizeof(rate_table_magic)];
+	std::uint64_t stored_hash;
+	std::uint64_t size;
+	fin.read(magic, sizeof(magic));
+	fin.read(reinterpret_cast<char*>(&stored_hash), sizeof(stored_hash));
+	fin.read(reinterpret_cast<char*>(&size), sizeof(size));
+	if (!fin || std::memcmp(magic, rate_table_magic, sizeof(magic)) != 0 || stored_hash != hash) return false;
+
+	m_log_temperature.resize(size);
+	m_log_rate.resize(size);
+	fin.read(reinterpret_cast<char*>(m_log_temperature.data()), size * sizeof(double));
+	fin.read(reinterpret_cast<char*>(m_log_rate.data()), size * sizeof(double));
+	return static_cast<bool>(fin);
+}
+
+/// @details Written to a temporary file first and renamed, so concurrent runs never read a partially written table
+void
+RateTable::write_cache(std::string_view cache_file, std::uint64_t hash) const
+{
+	std::filesystem::path final_path{ cache_file };
+	std::filesystem::path temp_path{ final_path };
+	temp_path += ".tmp";
+
+	std::uint64_t size{ m_log_temperature.size() };
+	std::ofstream fout(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+	assert(fout.is_open() && "Rate table cache file failed to open");
+	fout.write(rate_table_magic, sizeof(rate_table_magic));
+	fout.write(reinterpret_cast<char const*>(&hash), sizeof(hash));
+	fout.write(reinterpret_cast<char const*>(&size), sizeof(size));
+	fout.write(reinterpret_cast<char const*>(m_log_temperature.data()), size * sizeof(double));
+	fout.write(reinterpret_cast<char const*>(m_log_rate.data()), size * sizeof(double));
+	fout.close();
+
+	std::filesystem::rename(temp_path, final_path);
+}
\ No newline at end of file
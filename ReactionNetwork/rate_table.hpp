@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "cross_section.hpp"
+
+/// @brief The two-body state of a scattering channel, whose thermal average is tabulated
+/// @details For `TWO_TO_TWO` reactions these are the reactants, for `THREE_TO_TWO` reactions the products; in the
+/// latter case `cross_section` is the one for the inverse 2 -> 3 process.
+struct TwoBodyChannel {
+	double       mass_1;          // GeV
+	double       mass_2;          // GeV
+	double       degeneracy_1;
+	double       degeneracy_2;
+	CrossSection cross_section;
+};
+
+/// @brief Settings for the temperature grid of a `RateTable`
+struct RateTableGrid {
+	double      temperature_min{ 0.01 };    // GeV
+	double      temperature_max{ 1.0 };     // GeV
+	std::size_t initial_points{ 16 };       // Log-spaced points before refinement
+	double      tolerance{ 1e-4 };          // Allowed interpolation error in ln(C)
+	int         max_depth{ 8 };             // Maximum number of bisections of an initial interval
+};
+
+/// @brief Equilibrium rate density of a scattering channel, tabulated in temperature
+/// @details Stores C(T) = <sigma v> n_1,eq n_2,eq for the two-body state, in fm^-4, so that the rate equations for
+/// all reaction types take the same form as for decays, dn/dt = C(T) (prod_products n/n_eq - prod_reactants n/n_eq).
+/// Because of detailed balance, the same C(T) governs the forward and inverse reaction. The thermal average uses
+/// Maxwell-Boltzmann statistics (Gondolo and Gelmini, Nucl. Phys. B 360 (1991) 145),
+///     C(T) = g_1 g_2 T / (8 pi^4) int_{(m_1+m_2)^2}^infty ds sigma(s) p_cm^2(s) sqrt(s) K_1(sqrt(s) / T).
+/// The table stores ln(C) + (m_1 + m_2) / T, which removes the Boltzmann suppression at threshold and leaves a slowly
+/// varying function of ln(T). It is built on an adaptive grid, which bisects an interval until linear interpolation
+/// is accurate to `RateTableGrid::tolerance`, and is stored in a cache directory under a hash of the channel and grid.
+/// Temperatures outside of the grid are extrapolated, see `log_value`.
+/// Loading the same network again reads the table instead of recomputing it.
+/// The same grid also tabulates other Boltzmann-suppressed functions of the temperature, such as equilibrium densities,
+/// from their logarithm and threshold (without caching).
+class RateTable
+{
+	public:
+	/// @brief ln(f(T)) of the tabulated function
+	using LogFunction = std::function<double(double)>;
+
+	RateTable() = default;
+	RateTable(TwoBodyChannel const& channel, RateTableGrid const& grid, std::string_view cache_dir);
+	RateTable(LogFunction const& log_function, double threshold, RateTableGrid const& grid);
+
+	double operator()(double temperature) const { return std::exp(log_value(temperature)); }
+	double log_value(double temperature) const;
+
+	std::size_t size(void) const { return m_log_temperature.size(); }
+
+	private:
+	void build(LogFunction const& log_function, RateTableGrid const& grid);
+	double tabulated_value(LogFunction const& log_function, double log_T) const;
+	void   refine(
+	    LogFunction const&   log_function,
+	    RateTableGrid const& grid,
+	    double               log_T_lower,
+	    double               log_C_lower,
+	    double               log_T_upper,
+	    double               log_C_upper,
+	    int                  depth
+	);
+	bool read_cache(std::string_view cache_file, std::uint64_t hash);
+	void write_cache(std::string_view cache_file, std::uint64_t hash) const;
+
+	double              m_threshold{ 0.0 };    // m_1 + m_2
+	std::vector<double> m_log_temperature;
+	std::vector<double> m_log_rate;    // ln(C) + m_threshold / T
+};
+
+/// @brief ln(C(T)) for a two-body channel, see `RateTable`
+double log_equilibrium_rate(TwoBodyChannel const& channel, double temperature);
+
+/// @brief Exponentially scaled modified Bessel function of the second kind, e^z K_1(z)
+double bessel_k1_scaled(double z);
\ No newline at end of file
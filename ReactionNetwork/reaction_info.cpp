@@ -1,6 +1,28 @@
 #include "reaction_info.hpp"
 #include "particle.hpp"
 
+/// @brief Density update for `TWO_TO_TWO` and `THREE_TO_TWO` reactions, see `ReactionInfo::calculate`
+static void
+calculate_scattering(ReactionInfo const& info, double dt, double temperature, RK4Stage stage)
+{
+	auto saturation = [&](std::vector<std::shared_ptr<Particle>> const& particles) -> double
+	{
+		double ratio{ 1.0 };
+		for (auto particle : particles)
+			ratio *= (particle->get_density() + particle->get_RK4Stage_offset(stage)) /
+			         particle->get_eq_density(temperature);
+		return ratio;
+	};
+
+	// dn/dt = C(T) (n_c n_d / (n_c,eq n_d,eq) - n_a n_b / (n_a,eq n_b,eq)), by detailed balance
+	auto delta_density = (*info.rate_table)(temperature) * (saturation(info.products) - saturation(info.reactants));
+
+	for (auto reactant : info.reactants)
+		reactant->update(delta_density, dt, stage);
+	for (auto product : info.products)
+		product->update(-delta_density, dt, stage);
+}
+
 void
 ReactionInfo::calculate(std::shared_ptr<Particle> particle, double dt, double temperature, RK4Stage stage)
 {
@@ -27,6 +49,13 @@ ReactionInfo::calculate(std::shared_ptr<Particle> particle, double dt, double te
 			particle->update(delta_density, dt, stage);
 			for (auto product : products)
 				product->update(-delta_density, dt, stage);
+			break;
+		}
+		case ReactionType::TWO_TO_TWO :
+		case ReactionType::THREE_TO_TWO :
+		{
+			calculate_scattering(*this, dt, temperature, stage);
+			break;
 		}
 	}
 }
@@ -57,6 +86,46 @@ ReactionInfo::calculate(std::shared_ptr<Particle> particle, double dt, double te
 			particle->update(delta_density, dt, stage);
 			for (auto product : products)
 				product->update(-delta_density, dt, stage);
+			break;
+		}
+		case ReactionType::TWO_TO_TWO :
+		case ReactionType::THREE_TO_TWO :
+		{
+			calculate_scattering(*this, dt, temperature, stage);
+			break;
+		}
+	}
+}
+
+double
+ReactionInfo::rate(std::shared_ptr<Particle> particle, double temperature) const
+{
+	switch (reaction_type)
+	{
+		case ReactionType::DECAY :
+		{
+			auto eq_density  = particle->get_eq_density(temperature);
+			auto from_decays = particle->get_stage_density() / eq_density;
+
+			auto from_inv_decays = 1.0;
+			for (auto product : products)
+				from_inv_decays *= product->get_stage_density() / product->get_eq_density(temperature);
+
+			return reaction_rate * eq_density * (from_inv_decays - from_decays);
+		}
+		case ReactionType::TWO_TO_TWO :
+		case ReactionType::THREE_TO_TWO :
+		{
+			auto from_reactants = 1.0;
+			for (auto reactant : reactants)
+				from_reactants *= reactant->get_stage_density() / reactant->get_eq_density(temperature);
+
+			auto from_products = 1.0;
+			for (auto product : products)
+				from_products *= product->get_stage_density() / product->get_eq_density(temperature);
+
+			return (*rate_table)(temperature) * (from_products - from_reactants);
 		}
 	}
+	return 0.0;
 }
\ No newline at end of file
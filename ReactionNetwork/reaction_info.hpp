@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <vector>
 
+#include "rate_table.hpp"
 #include "reaction_type.hpp"
 #include "rk4_stages.hpp"
 
@@ -27,11 +28,21 @@ struct ReactionInfo {
 	/// for a reaction of type `type`. The expected order of the parameters is as follows
 	/// 	- Type::DECAY:
 	///         Expected arguments: (current_density,)
+	/// 	- Type::TWO_TO_TWO, Type::THREE_TO_TWO:
+	///         All `reactants` (including the owning particle) gain and all `products` lose
+	///         C(T) (prod_products n/n_eq - prod_reactants n/n_eq), with C(T) interpolated from `rate_table`
 	void calculate(std::shared_ptr<Particle> particle, double dt, double temperature, RK4Stage stage);
 	void calculate(std::shared_ptr<Particle> particle, double dt, double temperature, RK4Stage stage) const;
 
+	/// @brief Calculates the rate dn/dt at which this reaction changes the density of the owning particle
+	/// @details The other reactants change by the same amount, the products by minus this amount. All densities are
+	/// taken from `Particle::get_stage_density`, which has to be set for the current Runge-Kutta stage beforehand.
+	/// @param temperature double the background temperature corresponding to the current stage
+	double rate(std::shared_ptr<Particle> particle, double temperature) const;
+
 	ReactionType                           reaction_type;
 	double                                 reaction_rate;
 	std::vector<std::shared_ptr<Particle>> reactants;
 	std::vector<std::shared_ptr<Particle>> products;
+	std::shared_ptr<RateTable const>       rate_table;    // Only used for scattering reactions
 };
\ No newline at end of file
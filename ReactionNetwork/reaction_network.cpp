@@ -1,4 +1,5 @@
 // #include <format>
+#include <cmath>
 #include <string_view>
 
 #include "reaction_network.hpp"
@@ -25,9 +26,12 @@ ReactionNetwork::ReactionNetwork(std::string_view particle_datasheet, std::strin
 		auto spin_degen{ std::stod(entries[4]) };
 		auto num_decays{ std::stoull(entries.back()) };
 		auto spin_stat{ static_cast<int>(spin_degen) % 2 == 0 ? SpinStat::FD : SpinStat::BE };
+		ConservedCharges charges{ .baryon_number   = std::stod(entries[5]),
+			                      .strangeness     = std::stod(entries[6]),
+			                      .electric_charge = std::stod(entries[11]) };
 
 		// Particles that have one decay product are considered stable, and so we don't need to allocated
-		m_particles[pid] = std::make_shared<Particle>(pid, mass, spin_degen, width, spin_stat, num_decays);
+		m_particles[pid] = std::make_shared<Particle>(pid, mass, spin_degen, width, spin_stat, num_decays, charges);
 	}
 	fin.close();
 
@@ -56,34 +60,298 @@ ReactionNetwork::ReactionNetwork(std::string_view particle_datasheet, std::strin
 			std::vector<std::shared_ptr<Particle>> products;
 			for (int n = 0; n < n_daughters; ++n)
 				products.push_back(m_particles[std::stol(entries[3 + n])]);
+			// The partial width is converted from GeV to c/fm, the unit of the scattering rates C(T) / n_eq
 			ReactionInfo ri{ .reaction_type = ReactionType::DECAY,
-				             .reaction_rate = br * width,
+				             .reaction_rate = br * width / hbar,
 				             .reactants     = std::move(reactants),
-				             .products      = std::move(products) };
+				             .products      = std::move(products),
+				             .rate_table    = nullptr };
 			m_particles[pid]->add_reaction(std::move(ri));
 		}
 	}
 	// build_minimum_spanning_tree(m_dict[first_pid]);
 }
 
+/// @brief Adds 2 -> 2 and 3 -> 2 reactions and tabulates their thermally averaged rates
+/// @param scatterings_file path to file with one reaction per line (lines starting with `#` are skipped)
+/// @param cache_dir directory in which the rate tables are cached between runs; empty to disable caching
+/// @param grid temperature range and accuracy of the rate tables. Rates below `temperature_min` (0.01 GeV by default)
+/// or above `temperature_max` are extrapolated from the ends of the tables, so the range should cover the temperatures
+/// at which the scatterings matter
+/// @details File layout (by column name) [masses and widths in GeV, cross sections in mb]
+/// Type Model Model-parameters N-in PID-1 ... PID-N-in N-out PID-1 ... PID-N-out
+/// where Type is `TWO_TO_TWO` or `THREE_TO_TWO`, and Model is `CONSTANT` (sigma_0) or `BREIT_WIGNER` (sigma_max, mass,
+/// width), see `CrossSection`. For `THREE_TO_TWO` the cross section is that of the inverse 2 -> 3 reaction. Each
+/// reaction is owned by its first reactant. In `EvolutionMode::PARTIAL_EQUILIBRIUM` the effective-multiplicity matrix
+/// is rebuilt afterwards, since it points into the reaction lists that grow here, and the effective yields are taken
+/// from the current densities at the start of the next step. Function can fail due to file not existing or unknown
+/// particles, and will terminate program
+void
+ReactionNetwork::add_scatterings(std::string_view scatterings_file, std::string_view cache_dir, RateTableGrid grid)
+{
+	std::fstream fin(scatterings_file.data(), std::fstream::in);
+	assert(fin.is_open() && "Scatterings file failed to open");
+	sync_densities();
+
+	std::string line;
+	while (std::getline(fin, line))
+	{
+		auto entries{ split_string(line) };
+		if (entries.empty() || entries[0][0] == '#') continue;
+
+		std::size_t column{ 0 };
+		auto        type_name{ entries[column++] };
+		assert((type_name == "TWO_TO_TWO" || type_name == "THREE_TO_TWO") && "Unknown scattering type");
+		auto type{ type_name == "TWO_TO_TWO" ? ReactionType::TWO_TO_TWO : ReactionType::THREE_TO_TWO };
+
+		auto model_name{ entries[column++] };
+		assert((model_name == "CONSTANT" || model_name == "BREIT_WIGNER") && "Unknown cross section model");
+		CrossSection cross_section{ .model      = model_name == "CONSTANT" ? CrossSectionModel::CONSTANT
+		                                                                   : CrossSectionModel::BREIT_WIGNER,
+			                        .parameters = { 0.0, 0.0, 0.0 } };
+		auto num_parameters{ cross_section.model == CrossSectionModel::CONSTANT ? 1 : 3 };
+		for (int n{ 0 }; n < num_parameters; ++n)
+			cross_section.parameters[n] = std::stod(entries[column++]);
+
+		auto read_particles = [&]()
+		{
+			std::vector<std::shared_ptr<Particle>> particles;
+			auto                                   count{ std::stoi(entries[column++]) };
+			for (int n{ 0 }; n < count; ++n)
+			{
+				auto pid{ std::stol(entries[column++]) };
+				assert(m_particles.contains(pid) && "Scattering involves unknown particle");
+				particles.push_back(m_particles[pid]);
+			}
+			return particles;
+		};
+		auto reactants{ read_particles() };
+		auto products{ read_particles() };
+		assert(
+		    reactants.size() == (type == ReactionType::TWO_TO_TWO ? 2 : 3) && products.size() == 2 &&
+		    "Wrong number of particles for scattering type"
+		);
+
+		// The thermal average is taken over the two-body side of the reaction
+		auto const&    two_body{ type == ReactionType::TWO_TO_TWO ? reactants : products };
+		TwoBodyChannel channel{ .mass_1        = two_body[0]->get_mass(),
+			                    .mass_2        = two_body[1]->get_mass(),
+			                    .degeneracy_1  = two_body[0]->get_degeneracy(),
+			                    .degeneracy_2  = two_body[1]->get_degeneracy(),
+			                    .cross_section = cross_section };
+
+		auto         owner{ reactants[0] };
+		ReactionInfo ri{ .reaction_type = type,
+			             .reaction_rate = 0.0,
+			             .reactants     = std::move(reactants),
+			             .products      = std::move(products),
+			             .rate_table    = std::make_shared<RateTable const>(channel, grid, cache_dir) };
+		owner->add_reaction(std::move(ri));
+	}
+
+	if (m_mode == EvolutionMode::PARTIAL_EQUILIBRIUM)
+	{
+		m_partial_equilibrium = PartialEquilibrium(m_particles);
+		m_pce_initialized     = false;
+	}
+}
+
 void
 ReactionNetwork::initialize_system(double tau_0, double temperature)
 {
+	m_tau             = tau_0;
+	m_dt              = 0.0;
+	m_pce_initialized = false;
+	m_densities_stale = false;
 	for (auto [kye, particle] : m_particles)
 		particle->set_density(particle->get_eq_density(temperature));
 }
 
+/// @brief Selects which variables are integrated in time
+/// @param mode `EvolutionMode::DENSITY` (default) or `EvolutionMode::DENSITY_RATIO`
+/// @param reference_pid particle whose density the other densities are divided by in `EvolutionMode::DENSITY_RATIO`.
+/// A stable, abundant species (such as the pions) keeps the ratios of order one.
+/// @details Switching to `EvolutionMode::PARTIAL_EQUILIBRIUM` builds the effective-multiplicity matrix from the decays
+/// and scatterings loaded so far, and the effective yields are taken from the densities at the start of the next step.
+/// Selecting it again while it is active keeps the current effective yields, such as those restored from a checkpoint.
+/// Switching away from it first rebuilds the particle densities from the effective yields, so the other modes continue
+/// from the evolved state
+void
+ReactionNetwork::set_evolution_mode(EvolutionMode mode, long reference_pid)
+{
+	assert(
+	    (mode != EvolutionMode::DENSITY_RATIO || m_particles.contains(reference_pid)) &&
+	    "Reference particle for density ratios is not in the network"
+	);
+	if (mode == EvolutionMode::PARTIAL_EQUILIBRIUM && m_mode == EvolutionMode::PARTIAL_EQUILIBRIUM) return;
+	if (m_mode == EvolutionMode::PARTIAL_EQUILIBRIUM)
+	{
+		sync_densities();
+		m_pce_initialized = false;
+	}
+	m_mode          = mode;
+	m_reference_pid = reference_pid;
+
+	if (mode == EvolutionMode::PARTIAL_EQUILIBRIUM)
+	{
+		sync_densities();
+		m_partial_equilibrium = PartialEquilibrium(m_particles);
+		m_pce_initialized     = false;
+	}
+}
+
+/// @brief Rebuilds the particle densities from the effective yields, if the partial equilibrium mode has advanced them
+void
+ReactionNetwork::sync_densities(void)
+{
+	if (!m_densities_stale) return;
+	m_partial_equilibrium.rebuild_densities();
+	m_densities_stale = false;
+}
+
 /// @brief Preforms a partial time integration step of the Runge-Kutta 4th order algorithm
 /// @param double dt size of single time time step
 /// @param RK4Stage value from the enum class indicating which stage in the Runge-Kutta fourth order scheme to perform
 void
 ReactionNetwork::time_step(double dt, double temperature)
 {
+	assert(m_mode == EvolutionMode::DENSITY && "Evolving density ratios requires a background profile");
 	for (auto stage : std::vector<RK4Stage>{ RK4Stage::FIRST, RK4Stage::SECOND, RK4Stage::THIRD, RK4Stage::FOURTH })
+		calculate_stage(dt, temperature, stage);
+	finalize_time_step();
+	m_tau += dt;
+	m_dt = dt;
+}
+
+/// @brief Preforms a full Runge-Kutta 4th order time step with the temperature taken from a background profile
+/// @param double dt size of single time time step
+/// @param ProfileSource background that is evaluated at the time of each stage: tau, tau + dt/2 (twice), tau + dt
+/// @details The equilibrium densities are recalculated whenever the stage temperature changes, instead of being held
+/// fixed over the whole step. In `EvolutionMode::DENSITY_RATIO` the step is delegated to `ratio_time_step`, in
+/// `EvolutionMode::PARTIAL_EQUILIBRIUM` only the effective yields are advanced and the particle densities are
+/// rebuilt when they are next requested
+void
+ReactionNetwork::time_step(double dt, ProfileSource& profile)
+{
+	if (m_mode == EvolutionMode::DENSITY_RATIO)
+	{
+		ratio_time_step(dt, profile);
+		return;
+	}
+	if (m_mode == EvolutionMode::PARTIAL_EQUILIBRIUM)
+	{
+		if (!m_pce_initialized)
+		{
+			m_partial_equilibrium.initialize(profile.temperature(m_tau), profile.volume(m_tau));
+			m_pce_initialized = true;
+		}
+		m_partial_equilibrium.time_step(m_tau, dt, profile);
+		m_densities_stale = true;
+		m_tau += dt;
+		m_dt = dt;
+		return;
+	}
+
+	std::array<std::pair<RK4Stage, double>, 4> stages{
+		{{ RK4Stage::FIRST, 0.0 }, { RK4Stage::SECOND, 0.5 }, { RK4Stage::THIRD, 0.5 }, { RK4Stage::FOURTH, 1.0 }}
+	};
+
+	double previous_temperature{ std::numeric_limits<double>::quiet_NaN() };
+	for (auto [stage, offset] : stages)
+	{
+		double temperature{ profile.temperature(m_tau + offset * dt) };
+		if (temperature != previous_temperature)
+			for (auto [key, particle] : m_particles)
+				particle->invalidate_eq_density();
+		previous_temperature = temperature;
+		calculate_stage(dt, temperature, stage);
+	}
+	finalize_time_step();
+	m_tau += dt;
+	m_dt = dt;
+}
+
+/// @brief Preforms a full Runge-Kutta 4th order time step for the density ratios in an expanding volume
+/// @param double dt size of single time time step
+/// @param ProfileSource background that supplies the temperature and expansion rate at the time of each stage
+/// @details With dilution, the rate equations read dn_j/dt = R_j - n_j dln(V)/dt. For the ratios x_j = n_j / n_ref
+/// the dilution cancels, dx_j/dt = (R_j - x_j R_ref) / n_ref, and the reference density is evolved through
+/// dln(n_ref)/dt = R_ref / n_ref - dln(V)/dt. Both change slowly during the expansion-dominated phase, which allows
+/// for much larger time steps than evolving the densities directly. The RK4 stage variables of each particle store the
+/// increments of x_j, or of ln(n_ref) for the reference particle, and the densities are rebuilt at the end of the step
+void
+ReactionNetwork::ratio_time_step(double dt, ProfileSource& profile)
+{
+	std::array<std::pair<RK4Stage, double>, 4> stages{
+		{{ RK4Stage::FIRST, 0.0 }, { RK4Stage::SECOND, 0.5 }, { RK4Stage::THIRD, 0.5 }, { RK4Stage::FOURTH, 1.0 }}
+	};
+
+	auto   reference{ m_particles[m_reference_pid] };
+	double ref_density{ reference->get_density() };
+	assert(ref_density > 0.0 && "Reference particle for density ratios needs a positive density");
+
+	double previous_temperature{ std::numeric_limits<double>::quiet_NaN() };
+	for (auto [stage, offset] : stages)
+	{
+		double tau{ m_tau + offset * dt };
+		double temperature{ profile.temperature(tau) };
+		if (temperature != previous_temperature)
+			for (auto [key, particle] : m_particles)
+				particle->invalidate_eq_density();
+		previous_temperature = temperature;
+
+		// Convert the stage values of x_j and ln(n_ref) back to densities
+		double stage_ref_density{ ref_density * std::exp(reference->get_RK4Stage_offset(stage)) };
+		for (auto [key, particle] : m_particles)
+		{
+			double ratio{ particle->get_density() / ref_density + particle->get_RK4Stage_offset(stage) };
+			particle->set_stage_density(particle == reference ? stage_ref_density : ratio * stage_ref_density);
+		}
+
+		// Accumulate the net rates R_j
 		for (auto [key, particle] : m_particles)
 			for (auto const& reaction : particle->get_reactions())
-				reaction.calculate(particle, dt, temperature, stage);
-	finalize_time_step();
+			{
+				// Every reactant, including the owner and repeated species, loses one particle per reaction
+				auto rate = reaction.rate(particle, temperature);
+				for (auto reactant : reaction.reactants)
+					reactant->add_rate(rate);
+				for (auto product : reaction.products)
+					product->add_rate(-rate);
+			}
+
+		double ref_rate{ reference->take_rate() / stage_ref_density };
+		for (auto [key, particle] : m_particles)
+		{
+			if (particle == reference) continue;
+			double ratio{ particle->get_stage_density() / stage_ref_density };
+			particle->update(particle->take_rate() / stage_ref_density - ratio * ref_rate, dt, stage);
+		}
+		reference->update(ref_rate - profile.expansion_rate(tau), dt, stage);
+	}
+
+	double new_ref_density{ ref_density * std::exp(reference->get_RK4_increment()) };
+	for (auto [key, particle] : m_particles)
+	{
+		if (particle == reference) continue;
+		double ratio{ particle->get_density() / ref_density + particle->get_RK4_increment() };
+		particle->set_density(ratio * new_ref_density);
+		particle->reset_stages();
+	}
+	reference->set_density(new_ref_density);
+	reference->reset_stages();
+
+	m_tau += dt;
+	m_dt = dt;
+}
+
+/// @brief Accumulates the contributions of all reactions to the given Runge-Kutta 4th order stage
+void
+ReactionNetwork::calculate_stage(double dt, double temperature, RK4Stage stage)
+{
+	for (auto [key, particle] : m_particles)
+		for (auto const& reaction : particle->get_reactions())
+			reaction.calculate(particle, dt, temperature, stage);
 }
 
 /// @brief Combine the individual Runge-Kutte 4th order stages to preform update of particle densities after one full
@@ -93,4 +361,97 @@ ReactionNetwork::finalize_time_step()
 {
 	for (auto [key, particle] : m_particles)
 		particle->finalize_time_step();
+}
+
+/// @brief Writes the full integrator state to a binary checkpoint file
+/// @param path location of the checkpoint file
+/// @details The state is first packed into a contiguous buffer and written with `write_file_atomically`, so a run that
+/// is preempted or crashes while writing leaves the previous checkpoint intact. The evolution mode and, in
+/// `EvolutionMode::PARTIAL_EQUILIBRIUM`, the effective yields and chemical potentials are stored as well, so that a
+/// restarted run continues bit-for-bit; the densities are rebuilt from the effective yields without changing them.
+/// Returns `false` if the file cannot be written, the previous checkpoint is then left in place
+bool
+ReactionNetwork::write_checkpoint(std::string_view path)
+{
+	sync_densities();
+	CheckpointHeader header{ .magic          = {},
+		                     .version        = checkpoint_version,
+		                     .num_particles  = m_particles.size(),
+		                     .tau            = m_tau,
+		                     .dt             = m_dt,
+		                     .evolution_mode = static_cast<std::int64_t>(m_mode),
+		                     .reference_pid  = m_reference_pid };
+	std::memcpy(header.magic, checkpoint_magic, sizeof(checkpoint_magic));
+
+	PartialEquilibriumCheckpoint pce_state{ .num_yields = 0, .initialized = 0, .temperature = 0.0, .volume = 0.0 };
+	if (m_pce_initialized)
+	{
+		pce_state             = m_partial_equilibrium.save_state();
+		pce_state.initialized = 1;
+	}
+
+	std::vector<char> buffer(
+	    sizeof(header) + m_particles.size() * sizeof(ParticleCheckpoint) + sizeof(pce_state) +
+	    pce_state.num_yields * sizeof(YieldCheckpoint)
+	);
+	std::size_t offset{ 0 };
+	auto        append = [&](auto const& value)
+	{
+		std::memcpy(buffer.data() + offset, &value, sizeof(value));
+		offset += sizeof(value);
+	};
+	append(header);
+	for (auto const& [key, particle] : m_particles)
+		append(particle->save_state());
+	append(pce_state);
+	for (std::size_t i{ 0 }; i < pce_state.num_yields; ++i)
+		append(m_partial_equilibrium.save_yield(i));
+
+	return write_file_atomically(path, buffer);
+}
+
+/// @brief Restores the full integrator state from a binary checkpoint file
+/// @param path location of the checkpoint file written by `write_checkpoint`
+/// @details The reaction network has to be constructed from the same particle and decay files as the run that wrote
+/// the checkpoint, including the scatterings in `EvolutionMode::PARTIAL_EQUILIBRIUM`. Entries are matched by PID, so
+/// the iteration order of the particle list does not matter. The evolution mode is restored as well. Function can fail
+/// if the file does not exist or does not match the network, and will terminate program
+void
+ReactionNetwork::read_checkpoint(std::string_view path)
+{
+	std::ifstream fin(std::filesystem::path{ path }, std::ios::in | std::ios::binary);
+	assert(fin.is_open() && "Checkpoint file failed to open");
+
+	CheckpointHeader header;
+	fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+	assert(std::memcmp(header.magic, checkpoint_magic, sizeof(checkpoint_magic)) == 0 && "Not a checkpoint file");
+	assert(header.version == checkpoint_version && "Unsupported checkpoint version");
+	assert(header.num_particles == m_particles.size() && "Checkpoint does not match reaction network");
+
+	std::vector<ParticleCheckpoint> states(header.num_particles);
+	fin.read(reinterpret_cast<char*>(states.data()), states.size() * sizeof(ParticleCheckpoint));
+	assert(!fin.fail() && "Checkpoint file is truncated");
+
+	for (auto const& state : states)
+	{
+		auto particle = m_particles.find(state.pid);
+		assert(particle != m_particles.end() && "Checkpoint contains unknown particle");
+		particle->second->load_state(state);
+	}
+
+	PartialEquilibriumCheckpoint pce_state;
+	fin.read(reinterpret_cast<char*>(&pce_state), sizeof(pce_state));
+	std::vector<YieldCheckpoint> yields(pce_state.num_yields);
+	fin.read(reinterpret_cast<char*>(yields.data()), yields.size() * sizeof(YieldCheckpoint));
+	assert(!fin.fail() && "Checkpoint file is truncated");
+
+	m_tau             = header.tau;
+	m_dt              = header.dt;
+	m_densities_stale = false;
+
+	// Builds the effective-multiplicity matrix for the partial equilibrium mode (if not active yet) before its state is
+	// restored
+	set_evolution_mode(static_cast<EvolutionMode>(header.evolution_mode), header.reference_pid);
+	m_pce_initialized = pce_state.initialized != 0;
+	if (m_pce_initialized) m_partial_equilibrium.load_state(pce_state, yields);
 }
\ No newline at end of file
@@ -1,17 +1,27 @@
 #pragma once
 
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <utility>
 
+#include "checkpoint.hpp"
+#include "evolution_mode.hpp"
 #include "print.hpp"
+#include "profile_source.hpp"
+#include "rate_table.hpp"
 #include "reaction_type.hpp"
 #include "rk4_stages.hpp"
 #include "string_utility.hpp"
 
+#include "partial_equilibrium.hpp"
 #include "particle.hpp"
 #include "reaction_info.hpp"
 
@@ -24,14 +34,41 @@ class ReactionNetwork
 	ReactionNetwork() = default;
 	ReactionNetwork(std::string_view particle_datasheet, std::string_view particle_reactions);
 
+	void add_scatterings(std::string_view scatterings_file, std::string_view cache_dir, RateTableGrid grid = {});
 	void initialize_system(double tau_0, double temperature);
+	void set_evolution_mode(EvolutionMode mode, long reference_pid = 0);
 	void time_step(double dt, double temperature);
+	void time_step(double dt, ProfileSource& profile);
 	void finalize_time_step();
 
-	double get_particle_density(long pid) { return m_particles[pid]->get_density(); }
+	bool write_checkpoint(std::string_view path);
+	void read_checkpoint(std::string_view path);
+
+	double get_particle_density(long pid)
+	{
+		sync_densities();
+		return m_particles[pid]->get_density();
+	}
+
+	PartialEquilibrium const& get_partial_equilibrium(void) const { return m_partial_equilibrium; }
+
+	double get_tau(void) const { return m_tau; }
+
+	double get_dt(void) const { return m_dt; }
 
 	auto& get_particle_list() { return m_particles; }
 
 	private:
+	void calculate_stage(double dt, double temperature, RK4Stage stage);
+	void ratio_time_step(double dt, ProfileSource& profile);
+	void sync_densities(void);
+
 	std::unordered_map<long, std::shared_ptr<Particle>> m_particles;
+	double                                              m_tau{ 0.0 };    // Current time
+	double                                              m_dt{ 0.0 };     // Size of the last time step
+	EvolutionMode                                       m_mode{ EvolutionMode::DENSITY };
+	long                                                m_reference_pid{ 0 };    // Reference for density ratios
+	PartialEquilibrium                                  m_partial_equilibrium;
+	bool m_pce_initialized{ false };    // Effective yields have been set from the particle densities
+	bool m_densities_stale{ false };    // Particle densities lag behind the effective yields
 };
\ No newline at end of file
@@ -1,3 +1,6 @@
 #pragma once
 
-enum class ReactionType { DECAY };
\ No newline at end of file
+/// @brief Enum class for the kinds of reactions a particle can undergo
+/// @details `DECAY` uses the decay width times branching ratio as its rate. `TWO_TO_TWO` and `THREE_TO_TWO` use a
+/// thermally averaged cross section, which is tabulated in temperature by `RateTable`
+enum class ReactionType { DECAY, TWO_TO_TWO, THREE_TO_TWO };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include "spin_statistics.hpp"
+
+// Batched math kernels for thermal distributions. Every kernel is a single branch-free loop over contiguous arrays,
+// which the compiler auto-vectorizes; there are no explicit SIMD intrinsics. This needs -O2 or higher,
+// -fno-trapping-math (to turn the range checks into blends) and -fno-math-errno (for the square roots), and
+// -march=native (or another target with AVX) for vectors wider than the SSE2 baseline. Without these flags none of the
+// loops is vectorized. build.sh and test/run_checks.sh set all of them. Accuracy was measured against glibc on 10^7
+// random arguments in the stated ranges (test/thermal_kernels_check.cpp):
+//     batch_exp:   |x| <= 708, max error 1 ULP
+//     batch_expm1: |x| <= 708, max error 2 ULP
+//     batch_sqrt:  correctly rounded (0 ULP)
+// Occupation numbers inherit the error of the exponential plus one rounding each for the addition and division.
+
+/// @brief Evaluates e^x on a polynomial of the reduced argument |r| <= ln(2)/2
+/// @details Uses Cody-Waite range reduction x = k ln(2) + r and a degree-13 Taylor polynomial, whose truncation error
+/// is below 10^-17. Arguments below -708 (results close to the smallest normal double) are flushed to zero, arguments
+/// above the largest finite result give infinity.
+inline double
+exp_kernel(double x)
+{
+	constexpr double log2e  = 1.4426950408889634;
+	constexpr double ln2_hi = 6.93147180369123816490e-01;
+	constexpr double ln2_lo = 1.90821492927058770002e-10;
+	constexpr double shift  = 6755399441055744.0;    // 1.5 * 2^52, rounds to nearest integer when added
+	constexpr double x_max  = 709.782712893384;
+	constexpr double x_min  = -708.0;
+
+	double xc{ x < x_min ? x_min : (x > x_max ? x_max : x) };
+	double k_shifted{ xc * log2e + shift };
+	double kd{ k_shifted - shift };
+	double r{ (xc - kd * ln2_hi) - kd * ln2_lo };
+
+	double p{ 1.0 / 6227020800.0 };
+	p = p * r + 1.0 / 479001600.0;
+	p = p * r + 1.0 / 39916800.0;
+	p = p * r + 1.0 / 3628800.0;
+	p = p * r + 1.0 / 362880.0;
+	p = p * r + 1.0 / 40320.0;
+	p = p * r + 1.0 / 5040.0;
+	p = p * r + 1.0 / 720.0;
+	p = p * r + 1.0 / 120.0;
+	p = p * r + 1.0 / 24.0;
+	p = p * r + 1.0 / 6.0;
+	p = p * r + 0.5;
+	p = p * r + 1.0;
+	p = p * r + 1.0;
+
+	// Build 2^(k-1) directly in the exponent field, the integer k sits in the low mantissa bits of `k_shifted`.
+	// Using k-1 keeps k = 1024 (x close to x_max) representable
+	std::uint64_t k{ std::bit_cast<std::uint64_t>(k_shifted) - std::bit_cast<std::uint64_t>(shift) };
+	double        scale{ std::bit_cast<double>((k + 1022) << 52) };
+	double        result{ (2.0 * p) * scale };
+
+	result = x > x_max ? std::numeric_limits<double>::infinity() : result;
+	result = x < x_min ? 0.0 : result;
+	return result;
+}
+
+/// @brief Evaluates e^x - 1 without cancellation for small |x|
+/// @details For |x| < 1/2 a degree-17 Taylor polynomial is used, elsewhere `exp_kernel(x) - 1`, which loses at most
+/// one bit to cancellation at |x| = 1/2.
+inline double
+expm1_kernel(double x)
+{
+	double p{ 1.0 / 355687428096000.0 };
+	p = p * x + 1.0 / 20922789888000.0;
+	p = p * x + 1.0 / 1307674368000.0;
+	p = p * x + 1.0 / 87178291200.0;
+	p = p * x + 1.0 / 6227020800.0;
+	p = p * x + 1.0 / 479001600.0;
+	p = p * x + 1.0 / 39916800.0;
+	p = p * x + 1.0 / 3628800.0;
+	p = p * x + 1.0 / 362880.0;
+	p = p * x + 1.0 / 40320.0;
+	p = p * x + 1.0 / 5040.0;
+	p = p * x + 1.0 / 720.0;
+	p = p * x + 1.0 / 120.0;
+	p = p * x + 1.0 / 24.0;
+	p = p * x + 1.0 / 6.0;
+	p = p * x + 0.5;
+	p = p * x + 1.0;
+	p = p * x;
+
+	double large{ exp_kernel(x) - 1.0 };
+	return std::fabs(x) < 0.5 ? p : large;
+}
+
+/// @brief out[i] = e^{x[i]}
+inline void
+batch_exp(std::span<double const> x, std::span<double> out)
+{
+	for (std::size_t i{ 0 }; i < x.size(); ++i)
+		out[i] = exp_kernel(x[i]);
+}
+
+/// @brief out[i] = e^{x[i]} - 1
+inline void
+batch_expm1(std::span<double const> x, std::span<double> out)
+{
+	for (std::size_t i{ 0 }; i < x.size(); ++i)
+		out[i] = expm1_kernel(x[i]);
+}
+
+/// @brief out[i] = sqrt(x[i])
+inline void
+batch_sqrt(std::span<double const> x, std::span<double> out)
+{
+	for (std::size_t i{ 0 }; i < x.size(); ++i)
+		out[i] = std::sqrt(x[i]);
+}
+
+/// @brief out[i] = sqrt(q[i]^2 + mass^2)
+inline void
+batch_energy(std::span<double const> q, double mass, std::span<double> out)
+{
+	double mass2{ mass * mass };
+	for (std::size_t i{ 0 }; i < q.size(); ++i)
+		out[i] = std::sqrt(q[i] * q[i] + mass2);
+}
+
+/// @brief Occupation numbers f(E) for zero chemical potential, with the statistics fixed at compile time
+/// @details out[i] = e^{-E/T} (MB), 1 / (e^{E/T} + 1) (FD), or 1 / (e^{E/T} - 1) (BE). The Bose-Einstein distribution
+/// uses `expm1_kernel`, so it stays accurate for E << T.
+/// @param energy particle energies E
+/// @param inv_temperature 1 / T
+template<SpinStat spin_stat>
+inline void
+batch_occupation(std::span<double const> energy, double inv_temperature, std::span<double> out)
+{
+	for (std::size_t i{ 0 }; i < energy.size(); ++i)
+	{
+		double x{ energy[i] * inv_temperature };
+		if constexpr (spin_stat == SpinStat::MB) out[i] = exp_kernel(-x);
+		else if constexpr (spin_stat == SpinStat::FD) out[i] = 1.0 / (exp_kernel(x) + 1.0);
+		else out[i] = 1.0 / expm1_kernel(x);
+	}
+}
\ No newline at end of file
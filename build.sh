@@ -14,7 +14,9 @@ cd $build_dir
 src_files=`find ${src_dir} -name *.cpp | grep -v main`
 echo $src_files
 
-flags="-Wall -Wpedantic -Wextra -std=c++20 -g"
+# The thermal kernels only become SIMD code through auto-vectorization, which needs optimizations, a vector ISA
+# beyond the SSE2 baseline, and permission to ignore floating point traps and errno (see thermal_kernels.hpp)
+flags="-Wall -Wpedantic -Wextra -std=c++20 -g -O2 -march=native -fno-trapping-math -fno-math-errno"
 compiler=clang++
 
 for src in $src_files;
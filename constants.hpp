@@ -1,7 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <numbers>
 
 constexpr double hbar = 0.197;    // GeV fm
 
-double const pi = 4.0 * std::tan(1.0);
\ No newline at end of file
+constexpr double pi = std::numbers::pi;
\ No newline at end of file
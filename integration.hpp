@@ -29,7 +29,9 @@
 #ifndef INTEGRATION_HPP
 #define INTEGRATION_HPP
 
+#include <array>
 #include <cmath>
+#include <cstddef>
 #include <numeric>
 
 #include "constants.hpp"
@@ -224,4 +226,28 @@ gauss_quad(Functor &&func, double _low, double _high, double tol, int maxDepth,
 	return gaus_quad_aux(func, low, high, result, tol, maxDepth, improper_top, std::forward<Args>(args)...);
 }
 
+// Composite rule with `panels` equal panels of the 48-point rule on [0, 1], for integrands that are evaluated on all
+// nodes at once. Returns { nodes, weights }
+template<std::size_t panels>
+std::array<std::array<double, 2 * NSUM48 * panels>, 2>
+composite_gauss_legendre(void)
+{
+	std::array<std::array<double, 2 * NSUM48 * panels>, 2> rule;
+	auto &[nodes, weights] = rule;
+	double width           = 1.0 / panels;
+	for (std::size_t panel = 0; panel < panels; panel++)
+	{
+		double middle = (panel + 0.5) * width;
+		for (int i = 0; i < NSUM48; i++)
+		{
+			std::size_t n  = panel * 2 * NSUM48 + 2 * i;
+			nodes[n]       = middle - 0.5 * width * x48[i];
+			nodes[n + 1]   = middle + 0.5 * width * x48[i];
+			weights[n]     = 0.5 * width * w48[i];
+			weights[n + 1] = 0.5 * width * w48[i];
+		}
+	}
+	return rule;
+}
+
 #endif
\ No newline at end of file
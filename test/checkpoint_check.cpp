@@ -0,0 +1,122 @@
+// Restarting from a checkpoint has to reproduce an uninterrupted run bit-for-bit in every evolution mode, and writing a
+// checkpoint must not change the run that wrote it. Uses a pi/K/rho network with one pi pi -> K K channel. A checkpoint
+// that cannot be written has to be reported and leave the previous checkpoint intact
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/profile_source.hpp"
+#include "../ReactionNetwork/reaction_network.hpp"
+
+constexpr double tau_0{ 0.1 };
+constexpr double temperature_0{ 0.3 };
+constexpr double dt{ 0.001 };
+constexpr char   checkpoint_file[] = "checkpoint_check.bin";
+
+static ReactionNetwork
+make_network(EvolutionMode mode)
+{
+	ReactionNetwork rn("kaons.dat", "kaon_decays.dat");
+	rn.add_scatterings("kaon_scatterings.dat", "");
+	rn.initialize_system(tau_0, temperature_0);
+	rn.set_evolution_mode(mode, 211);
+	return rn;
+}
+
+static AnalyticProfile
+make_profile(void)
+{
+	return AnalyticProfile(
+	    [](double tau) -> double { return temperature_0 * std::pow(tau_0 / tau, 1.0 / 3.0); },
+	    [](double tau) -> double { return tau / tau_0; }
+	);
+}
+
+static bool
+bitwise_equal(ReactionNetwork& a, ReactionNetwork& b, char const* label)
+{
+	bool equal{ true };
+	for (long pid : { 211L, -211L, 321L, -321L, 113L })
+	{
+		double x{ a.get_particle_density(pid) };
+		double y{ b.get_particle_density(pid) };
+		if (std::memcmp(&x, &y, sizeof(double)) != 0)
+		{
+			std::printf("%s: pid %ld differs, %.17g vs %.17g\n", label, pid, x, y);
+			equal = false;
+		}
+	}
+	return equal;
+}
+
+int
+main()
+{
+	bool passed{ true };
+	for (auto [mode, name] : std::vector<std::pair<EvolutionMode, char const*>>{
+	         { EvolutionMode::DENSITY, "DENSITY" },
+	         { EvolutionMode::DENSITY_RATIO, "DENSITY_RATIO" },
+	         { EvolutionMode::PARTIAL_EQUILIBRIUM, "PARTIAL_EQUILIBRIUM" }
+    })
+	{
+		auto profile{ make_profile() };
+		auto straight{ make_network(mode) };
+		for (int n{ 0 }; n < 200; ++n)
+			straight.time_step(dt, profile);
+
+		// Writing the checkpoint must not change the run that wrote it
+		auto writer_profile{ make_profile() };
+		auto writer{ make_network(mode) };
+		for (int n{ 0 }; n < 100; ++n)
+			writer.time_step(dt, writer_profile);
+		bool written{ writer.write_checkpoint(checkpoint_file) };
+		for (int n{ 0 }; n < 100; ++n)
+			writer.time_step(dt, writer_profile);
+
+		// A fresh network restored from the checkpoint
+		auto            restored_profile{ make_profile() };
+		ReactionNetwork restored("kaons.dat", "kaon_decays.dat");
+		restored.add_scatterings("kaon_scatterings.dat", "");
+		restored.read_checkpoint(checkpoint_file);
+		for (int n{ 0 }; n < 100; ++n)
+			restored.time_step(dt, restored_profile);
+
+		bool mode_passed{ written && bitwise_equal(straight, writer, name) && bitwise_equal(straight, restored, name) };
+		print(name, mode_passed ? "bit-for-bit" : "DIFFERS");
+		passed = passed && mode_passed;
+	}
+
+	// Failed writes: the temporary file cannot be created, once because it is taken by a directory and once because
+	// the target directory does not exist
+	{
+		auto read_file = [](char const* path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+		auto previous{ read_file(checkpoint_file) };
+		auto rn{ make_network(EvolutionMode::DENSITY) };
+		rn.time_step(dt, 0.25);
+
+		std::string temp_file{ std::string(checkpoint_file) + ".tmp" };
+		std::filesystem::create_directory(temp_file);
+		bool blocked{ !rn.write_checkpoint(checkpoint_file) && read_file(checkpoint_file) == previous };
+		std::filesystem::remove(temp_file);
+		bool missing{ !rn.write_checkpoint("missing_directory/checkpoint.bin") &&
+			          !std::filesystem::exists("missing_directory") };
+
+		bool failure_passed{ !previous.empty() && blocked && missing };
+		print("failed write", failure_passed ? "reported, previous checkpoint kept" : "NOT HANDLED");
+		passed = passed && failure_passed;
+	}
+	std::filesystem::remove(checkpoint_file);
+
+	print(passed ? "checkpoint check passed" : "checkpoint check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+// Dilution in a volume V = tau / tau_0. For two stable pion species at constant temperature there are no reactions, so
+// dn/dt = -n dln(V)/dt and `DENSITY_RATIO` has to reproduce n(tau) / n(tau_0) = tau_0 / tau exactly. With reactions
+// (the toy network and `scatterings.dat`) in a cooling Bjorken-like profile, the dilution has to enter `DENSITY_RATIO`
+// and `Ensemble<double>` the same way, so both have to agree
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include "../ReactionNetwork/ensemble.hpp"
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/profile_source.hpp"
+#include "../ReactionNetwork/reaction_network.hpp"
+
+int
+main()
+{
+	double tau_0{ 0.1 };
+	double tau_f{ 1.0 };
+	double dt{ 0.01 };
+	double temperature{ 0.15 };
+	int    steps{ static_cast<int>(std::round((tau_f - tau_0) / dt)) };
+	bool   passed{ true };
+
+	// Pure dilution of stable species
+	{
+		AnalyticProfile profile(
+		    [&](double) -> double { return temperature; },
+		    [&](double tau) -> double { return tau / tau_0; }
+		);
+
+		ReactionNetwork rn("pions.dat", "pion_decays.dat");
+		rn.initialize_system(tau_0, temperature);
+		rn.set_evolution_mode(EvolutionMode::DENSITY_RATIO, 211);
+		double n0_plus{ rn.get_particle_density(211) };
+		double n0_minus{ rn.get_particle_density(-211) };
+
+		for (int n{ 0 }; n < steps; ++n)
+			rn.time_step(dt, profile);
+
+		double expected{ tau_0 / rn.get_tau() };
+		double error_plus{ std::fabs(rn.get_particle_density(211) / n0_plus / expected - 1.0) };
+		double error_minus{ std::fabs(rn.get_particle_density(-211) / n0_minus / expected - 1.0) };
+		print("DENSITY_RATIO: n/n0 =", rn.get_particle_density(211) / n0_plus, "expected", expected);
+		print("    relative errors", error_plus, error_minus);
+		passed = passed && error_plus < 1e-6 && error_minus < 1e-6;
+	}
+
+	// Dilution together with decays and scatterings
+	{
+		auto profile{ std::make_shared<AnalyticProfile>(
+			[&](double tau) -> double { return temperature * std::pow(tau_0 / tau, 1.0 / 3.0); },
+			[&](double tau) -> double { return tau / tau_0; }
+		) };
+
+		ReactionNetwork rn("particles.dat", "decays.dat");
+		rn.add_scatterings("scatterings.dat", "");
+		rn.initialize_system(tau_0, temperature);
+		rn.set_evolution_mode(EvolutionMode::DENSITY_RATIO, 211);
+
+		ReactionNetwork ensemble_network("particles.dat", "decays.dat");
+		ensemble_network.add_scatterings("scatterings.dat", "");
+		Ensemble<double> ensemble(ensemble_network, { profile });
+		ensemble.initialize_system(tau_0);
+
+		// Start both from the exact equilibrium densities of the network, the ensemble interpolates its own to 10^-6
+		for (auto const& [pid, particle] : rn.get_particle_list())
+			ensemble.set_density(0, pid, rn.get_particle_density(pid));
+
+		for (int n{ 0 }; n < steps; ++n)
+		{
+			rn.time_step(dt, *profile);
+			ensemble.time_step(dt);
+		}
+
+		double max_error{ 0.0 };
+		for (long pid : { 111L, 211L, -211L, 113L, 221L, 2212L, 2112L })
+		{
+			double error{ std::fabs(rn.get_particle_density(pid) / ensemble.get_density(0, pid) - 1.0) };
+			max_error = std::max(max_error, error);
+		}
+		print("DENSITY_RATIO with reactions against Ensemble<double>: max relative error", max_error);
+		passed = passed && max_error < 1e-6;
+	}
+
+	print(passed ? "dilution check passed" : "dilution check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// Float ensembles against the double-precision ensemble: the toy network of pions, rho, eta and nucleons in linear and
+// log storage, and a 3.5 GeV resonance decaying to pi+ pi-, whose equilibrium density drops below the float range as
+// the cells cool (same cells and steps as main.cpp). Also checks that the tabulated equilibrium densities match
+// `Particle::calculate_eq_density`, that `accuracy_report` flags non-finite densities, and that a run restarted from
+// a checkpoint ends bit-for-bit where the uninterrupted run ends
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+#include "../ReactionNetwork/ensemble.hpp"
+#include "../ReactionNetwork/print.hpp"
+
+constexpr double tau_0{ 0.1 };
+constexpr double dtau{ tau_0 / 20.0 };
+constexpr int    num_steps{ 50 };
+constexpr char   checkpoint_file[] = "ensemble_check.bin";
+
+static std::vector<std::shared_ptr<ProfileSource>>
+make_cells(void)
+{
+	std::vector<std::shared_ptr<ProfileSource>> cells;
+	for (double cell_temperature : { 0.150, 0.155, 0.160, 0.165 })
+		cells.push_back(std::make_shared<AnalyticProfile>(
+		    [=](double tau) -> double { return cell_temperature * std::exp(4.0 / 3.0 * std::log(tau_0 / tau)); },
+		    [=](double tau) -> double { return tau / tau_0; }
+		));
+	return cells;
+}
+
+template<typename... Ensembles>
+static void
+advance(Ensembles&... ensembles)
+{
+	(ensembles.initialize_system(tau_0), ...);
+	for (int n{ 0 }; n < num_steps; ++n)
+		(ensembles.time_step(dtau), ...);
+}
+
+int
+main()
+{
+	bool passed{ true };
+	auto check = [&](char const* label, AccuracyReport const& report, double tolerance)
+	{
+		bool ok{ report.non_finite_values == 0 && report.max_relative_error <= tolerance };
+		print(label, "max", report.max_relative_error, "rms", report.rms_relative_error);
+		print("    charge", report.max_charge_error, "non-finite", report.non_finite_values, ok ? "ok" : "FAILED");
+		passed = passed && ok;
+	};
+
+	{
+		ReactionNetwork rn("particles.dat", "decays.dat");
+		rn.add_scatterings("scatterings.dat", "");
+		auto cells{ make_cells() };
+
+		Ensemble<double>                    reference(rn, cells);
+		Ensemble<float>                     linear(rn, cells);
+		Ensemble<float, StateEncoding::LOG> log(rn, cells);
+		advance(reference, linear, log);
+		check("toy network, linear float", accuracy_report(linear, reference), 1e-5);
+		check("toy network, log float", accuracy_report(log, reference), 1e-4);
+
+		// The state of a cell is initialized from the tables
+		Ensemble<double> fresh(rn, cells);
+		fresh.initialize_system(tau_0);
+		double temperature{ cells[0]->temperature(tau_0) };
+		double table_error{ 0.0 };
+		for (auto [pid, particle] : rn.get_particle_list())
+			table_error = std::max(
+			    table_error,
+			    std::fabs(fresh.get_density(0, pid) / particle->calculate_eq_density(temperature) - 1.0)
+			);
+		print("tabulated equilibrium densities", table_error, table_error <= 1e-6 ? "ok" : "FAILED");
+		passed = passed && table_error <= 1e-6;
+
+		linear.set_density(1, 211, std::numeric_limits<double>::quiet_NaN());
+		auto report{ accuracy_report(linear, reference) };
+		bool flagged{ report.non_finite_values != 0 && std::isinf(report.max_relative_error) && report.worst_cell == 1 &&
+			          report.worst_pid == 211 };
+		print("NaN density flagged", flagged ? "ok" : "FAILED");
+		passed = passed && flagged;
+	}
+
+	{
+		ReactionNetwork rn("resonance.dat", "resonance_decays.dat");
+		auto            cells{ make_cells() };
+
+		Ensemble<double>                    reference(rn, cells);
+		Ensemble<float>                     linear(rn, cells);
+		Ensemble<float, StateEncoding::LOG> log(rn, cells);
+		advance(reference, linear, log);
+		check("3.5 GeV resonance, linear float", accuracy_report(linear, reference), 1e-5);
+		check("3.5 GeV resonance, log float", accuracy_report(log, reference), 1e-4);
+	}
+
+	{
+		ReactionNetwork rn("particles.dat", "decays.dat");
+		rn.add_scatterings("scatterings.dat", "");
+		auto cells{ make_cells() };
+
+		Ensemble<float, StateEncoding::LOG> straight(rn, cells);
+		advance(straight);
+
+		Ensemble<float, StateEncoding::LOG> writer(rn, cells);
+		writer.initialize_system(tau_0);
+		for (int n{ 0 }; n < num_steps / 2; ++n)
+			writer.time_step(dtau);
+		passed = writer.write_checkpoint(checkpoint_file) && passed;
+
+		Ensemble<float, StateEncoding::LOG> restored(rn, cells);
+		restored.read_checkpoint(checkpoint_file);
+		for (int n{ num_steps / 2 }; n < num_steps; ++n)
+			restored.time_step(dtau);
+		std::filesystem::remove(checkpoint_file);
+
+		bool identical{ restored.get_tau() == straight.get_tau() };
+		for (std::size_t cell{ 0 }; cell < straight.num_cells(); ++cell)
+			for (auto pid : straight.get_pids())
+			{
+				double x{ straight.get_density(cell, pid) };
+				double y{ restored.get_density(cell, pid) };
+				identical = identical && std::memcmp(&x, &y, sizeof(double)) == 0;
+			}
+		print("restart from checkpoint", identical ? "bit-for-bit" : "DIFFERS");
+		passed = passed && identical;
+	}
+
+	print(passed ? "ensemble check passed" : "ensemble check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+// Equilibrium densities from Particle::calculate_eq_density against the Bessel-function series
+//     n_eq = g / (2 pi^2 hbar^3) sum_k (+-1)^(k+1) m^2 T / k K_2(k m / T),
+// and against the closed form g zeta(3) T^3 / (pi^2 hbar^3) for massless bosons. The reference uses std::numbers::pi
+// directly, so it does not share constants with the code it checks
+
+#include <cmath>
+#include <numbers>
+
+#include "../ReactionNetwork/particle.hpp"
+#include "../ReactionNetwork/print.hpp"
+
+static double
+series_density(double mass, double degeneracy, double temperature, SpinStat spin_stat)
+{
+	double sum{ 0.0 };
+	int    terms{ spin_stat == SpinStat::MB ? 1 : 400 };
+	for (int k{ 1 }; k <= terms; ++k)
+	{
+		double sign{ spin_stat == SpinStat::FD && k % 2 == 0 ? -1.0 : 1.0 };
+		sum += sign * mass * mass * temperature / k * std::cyl_bessel_k(2.0, k * mass / temperature);
+	}
+	return degeneracy * sum / (2.0 * std::numbers::pi * std::numbers::pi) / std::pow(hbar, 3);
+}
+
+int
+main()
+{
+	struct Case {
+		double   mass;
+		double   degeneracy;
+		double   temperature;
+		SpinStat spin_stat;
+	};
+	Case cases[] = {
+		{0.13957, 1.0,  0.15, SpinStat::BE},
+		{0.13957, 1.0,   0.5, SpinStat::BE},
+		{  0.938, 2.0,  0.15, SpinStat::FD},
+		{  0.938, 2.0,  0.15, SpinStat::MB},
+		{    2.5, 3.0,  0.02, SpinStat::BE},
+		{0.13957, 1.0, 0.005, SpinStat::BE}
+	};
+
+	bool passed{ true };
+	for (auto const& c : cases)
+	{
+		Particle particle(1, c.mass, c.degeneracy, 0.0, c.spin_stat, 0);
+		double   density{ particle.calculate_eq_density(c.temperature) };
+		double   error{ std::fabs(density / series_density(c.mass, c.degeneracy, c.temperature, c.spin_stat) - 1.0) };
+		print("m =", c.mass, "T =", c.temperature, "n_eq =", density, "relative error", error);
+		passed = passed && error < 1e-9;
+	}
+
+	// Massless bosons: n = g zeta(3) T^3 / (pi^2 hbar^3)
+	double   temperature{ 0.2 };
+	Particle photon(22, 0.0, 2.0, 0.0, SpinStat::BE, 0);
+	double   zeta3{ 1.2020569031595942 };
+	double   expected{ 2.0 * zeta3 * std::pow(temperature / hbar, 3) / (std::numbers::pi * std::numbers::pi) };
+	double   error{ std::fabs(photon.calculate_eq_density(temperature) / expected - 1.0) };
+	print("massless boson relative error", error);
+	passed = passed && error < 1e-6;
+
+	print(passed ? "equilibrium density check passed" : "equilibrium density check FAILED");
+	return passed ? 0 : 1;
+}
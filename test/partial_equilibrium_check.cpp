@@ -0,0 +1,151 @@
+// Partial chemical equilibrium on the toy pion/rho/eta/nucleon network under a Bjorken profile: without scatterings
+// the effective pion number is conserved and the rho stays in relative equilibrium with its daughters; the
+// scatterings conserve baryon number, and adding them after selecting the mode gives the same run as adding them
+// before. Switching to `DENSITY` halfway has to continue from the evolved densities, whether or not they were
+// requested first
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/profile_source.hpp"
+#include "../ReactionNetwork/reaction_network.hpp"
+
+constexpr double tau_0{ 1.0 };
+constexpr double temperature_0{ 0.15 };
+constexpr double dt{ 0.01 };
+constexpr int    num_steps{ 300 };
+
+static AnalyticProfile
+make_profile(void)
+{
+	return AnalyticProfile(
+	    [](double tau) -> double { return temperature_0 * std::pow(tau_0 / tau, 1.0 / 3.0); },
+	    [](double tau) -> double { return tau / tau_0; }
+	);
+}
+
+// Number of pions, counting the rho and eta through their decays, in the volume tau / tau_0
+static double
+pion_number(ReactionNetwork& rn)
+{
+	double density{ rn.get_particle_density(111) + rn.get_particle_density(211) + rn.get_particle_density(-211) };
+	density += 2.0 * rn.get_particle_density(113) + 2.0 * rn.get_particle_density(221);
+	return density * rn.get_tau() / tau_0;
+}
+
+static double
+baryon_number(ReactionNetwork& rn)
+{
+	return (rn.get_particle_density(2212) + rn.get_particle_density(2112)) * rn.get_tau() / tau_0;
+}
+
+static double
+saturation(ReactionNetwork& rn, long pid, double temperature)
+{
+	return rn.get_particle_density(pid) / rn.get_particle_list()[pid]->get_eq_density(temperature);
+}
+
+int
+main()
+{
+	bool passed{ true };
+	auto check = [&](char const* label, double error, double tolerance)
+	{
+		print(label, error, error <= tolerance ? "ok" : "FAILED");
+		passed = passed && error <= tolerance;
+	};
+
+	// Decays only: the effective yields are constant
+	{
+		auto            profile{ make_profile() };
+		ReactionNetwork rn("particles.dat", "decays.dat");
+		rn.initialize_system(tau_0, temperature_0);
+		rn.set_evolution_mode(EvolutionMode::PARTIAL_EQUILIBRIUM);
+		double pions_0{ pion_number(rn) };
+		for (int n{ 0 }; n < num_steps; ++n)
+			rn.time_step(dt, profile);
+
+		double temperature{ profile.temperature(rn.get_tau()) };
+		check("effective pion number drift", std::abs(pion_number(rn) / pions_0 - 1.0), 1e-13);
+		double pion_saturation{ saturation(rn, 211, temperature) * saturation(rn, -211, temperature) };
+		check("rho fugacity vs pi+ pi-", std::abs(saturation(rn, 113, temperature) / pion_saturation - 1.0), 1e-12);
+	}
+
+	// With scatterings, added before and after selecting the mode
+	{
+		auto            profile_before{ make_profile() };
+		ReactionNetwork before("particles.dat", "decays.dat");
+		before.add_scatterings("scatterings.dat", "");
+		before.initialize_system(tau_0, temperature_0);
+		before.set_evolution_mode(EvolutionMode::PARTIAL_EQUILIBRIUM);
+
+		auto            profile_after{ make_profile() };
+		ReactionNetwork after("particles.dat", "decays.dat");
+		after.initialize_system(tau_0, temperature_0);
+		after.set_evolution_mode(EvolutionMode::PARTIAL_EQUILIBRIUM);
+		after.add_scatterings("scatterings.dat", "");
+
+		double baryons_0{ baryon_number(before) };
+		for (int n{ 0 }; n < num_steps; ++n)
+		{
+			before.time_step(dt, profile_before);
+			after.time_step(dt, profile_after);
+		}
+		check("baryon number drift", std::abs(baryon_number(before) / baryons_0 - 1.0), 1e-12);
+
+		bool identical{ true };
+		for (long pid : { 111L, 211L, -211L, 113L, 221L, 2212L, 2112L })
+		{
+			double x{ before.get_particle_density(pid) };
+			double y{ after.get_particle_density(pid) };
+			identical = identical && std::memcmp(&x, &y, sizeof(double)) == 0;
+		}
+		print("scatterings added after the mode", identical ? "bit-for-bit" : "DIFFERS");
+		passed = passed && identical;
+	}
+
+	// Switching to DENSITY halfway, with and without requesting the densities before the switch
+	{
+		auto            profile_requested{ make_profile() };
+		ReactionNetwork requested("particles.dat", "decays.dat");
+		requested.add_scatterings("scatterings.dat", "");
+		requested.initialize_system(tau_0, temperature_0);
+		requested.set_evolution_mode(EvolutionMode::PARTIAL_EQUILIBRIUM);
+
+		auto            profile_switched{ make_profile() };
+		ReactionNetwork switched("particles.dat", "decays.dat");
+		switched.add_scatterings("scatterings.dat", "");
+		switched.initialize_system(tau_0, temperature_0);
+		switched.set_evolution_mode(EvolutionMode::PARTIAL_EQUILIBRIUM);
+
+		for (int n{ 0 }; n < num_steps / 2; ++n)
+		{
+			requested.time_step(dt, profile_requested);
+			switched.time_step(dt, profile_switched);
+		}
+		double halfway{ requested.get_particle_density(211) };
+		requested.set_evolution_mode(EvolutionMode::DENSITY);
+		switched.set_evolution_mode(EvolutionMode::DENSITY);
+		for (int n{ num_steps / 2 }; n < num_steps; ++n)
+		{
+			requested.time_step(dt, profile_requested);
+			switched.time_step(dt, profile_switched);
+		}
+
+		bool identical{ true };
+		for (long pid : { 111L, 211L, -211L, 113L, 221L, 2212L, 2112L })
+		{
+			double x{ requested.get_particle_density(pid) };
+			double y{ switched.get_particle_density(pid) };
+			identical = identical && std::memcmp(&x, &y, sizeof(double)) == 0;
+		}
+		bool evolved{ requested.get_particle_density(211) != halfway };
+		print("switch to DENSITY", identical && evolved ? "continues from the evolved densities" : "FAILED");
+		passed = passed && identical && evolved;
+	}
+
+	print(passed ? "partial equilibrium check passed" : "partial equilibrium check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Background sources at the times requested by the RK4 stages (tau, tau + dt/2, tau + dt):
+// - `SharedMemoryProfileProducer` streams an `AnalyticProfile` on a separate thread into a ring buffer, long enough to
+//   wrap it twice, and `SharedMemoryProfile` has to reproduce the analytic temperature, volume and expansion rate up to
+//   the last record
+// - `TabulatedProfile` reads `profile.dat` (linear in tau, with comments and blank lines) three rows at a time, and
+//   has to interpolate it exactly up to a request at the last row
+
+#include <cmath>
+#include <thread>
+
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/profile_source.hpp"
+
+int
+main()
+{
+	bool passed{ true };
+	auto check = [&](char const* label, double error, double tolerance)
+	{
+		print(label, error, error <= tolerance ? "ok" : "FAILED");
+		passed = passed && error <= tolerance;
+	};
+
+	// Shared-memory ring buffer, fed by a producer thread
+	{
+		double tau_0{ 1.0 };
+		double tau_f{ 11.0 };
+		double sample_spacing{ 1e-3 };
+		double dt{ 0.0137 };    // Stage times fall in between the samples
+
+		AnalyticProfile analytic(
+		    [&](double tau) -> double { return 0.2 * std::pow(tau_0 / tau, 1.0 / 3.0); },
+		    [&](double tau) -> double { return tau / tau_0; }
+		);
+		AnalyticProfile source(analytic);
+
+		SharedMemoryProfileProducer producer("/reaction_network_profile_check");
+		SharedMemoryProfile         consumer("/reaction_network_profile_check");
+		std::thread                 hydro([&] { producer.stream(source, tau_0, tau_f, sample_spacing); });
+
+		// The producer samples tau_0 + n * spacing for n = 0, ..., num_samples - 1
+		auto   num_samples{ static_cast<std::size_t>(std::ceil((tau_f - tau_0) / sample_spacing)) + 1 };
+		double tau_last{ tau_0 + (num_samples - 1) * sample_spacing };
+		print("streamed records", num_samples, "ring capacity", profile_ring_capacity);
+
+		double temperature_error{ 0.0 };
+		double volume_error{ 0.0 };
+		double expansion_error{ 0.0 };
+		auto   compare = [&](double tau)
+		{
+			temperature_error = std::max(
+			    temperature_error,
+			    std::fabs(consumer.temperature(tau) / analytic.temperature(tau) - 1.0)
+			);
+			volume_error = std::max(volume_error, std::fabs(consumer.volume(tau) / analytic.volume(tau) - 1.0));
+			expansion_error = std::max(
+			    expansion_error,
+			    std::fabs(consumer.expansion_rate(tau) / analytic.expansion_rate(tau) - 1.0)
+			);
+		};
+		for (double tau{ tau_0 }; tau + dt < tau_last; tau += dt)
+			for (double offset : { 0.0, 0.5, 0.5, 1.0 })
+				compare(tau + offset * dt);
+		compare(tau_last);
+		hydro.join();
+
+		check("shared memory: temperature", temperature_error, 1e-7);
+		check("shared memory: volume", volume_error, 1e-12);
+		check("shared memory: expansion rate", expansion_error, 1e-8);
+	}
+
+	// Tabulated file, read in small chunks
+	{
+		TabulatedProfile tabulated("profile.dat", 3);
+		double           dt{ 0.05 };
+
+		double temperature_error{ 0.0 };
+		double volume_error{ 0.0 };
+		double expansion_error{ 0.0 };
+		auto   compare = [&](double tau)
+		{
+			temperature_error =
+			    std::max(temperature_error, std::fabs(tabulated.temperature(tau) - (0.2 - 0.05 * (tau - 1.0))));
+			volume_error    = std::max(volume_error, std::fabs(tabulated.volume(tau) - 2.0 * tau));
+			expansion_error = std::max(expansion_error, std::fabs(tabulated.expansion_rate(tau) - 1.0 / tau));
+		};
+		for (int n{ 0 }; n < 20; ++n)
+			for (double offset : { 0.0, 0.5, 0.5, 1.0 })
+				compare(1.0 + (n + offset) * dt);
+		compare(2.0);
+
+		check("tabulated: temperature", temperature_error, 1e-12);
+		check("tabulated: volume", volume_error, 1e-12);
+		check("tabulated: expansion rate", expansion_error, 1e-12);
+	}
+
+	print(passed ? "profile source check passed" : "profile source check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Tabulated equilibrium rate densities against a direct midpoint-rule integral of the Gondolo-Gelmini formula,
+//     C(T) = g_1 g_2 T / (8 pi^4) int ds sigma(s) p_cm^2(s) sqrt(s) K_1(sqrt(s) / T),
+// evaluated with std::cyl_bessel_k and std::numbers::pi, independently of rate_table.cpp
+
+#include <cmath>
+#include <numbers>
+
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/rate_table.hpp"
+
+static double
+midpoint_rate(TwoBodyChannel const& channel, double temperature)
+{
+	double      m1{ channel.mass_1 };
+	double      m2{ channel.mass_2 };
+	double      s_min{ (m1 + m2) * (m1 + m2) };
+	double      s_max{ (m1 + m2 + 60.0 * temperature) * (m1 + m2 + 60.0 * temperature) };
+	std::size_t intervals{ 2000000 };
+	double      ds{ (s_max - s_min) / intervals };
+
+	double integral{ 0.0 };
+	for (std::size_t i{ 0 }; i < intervals; ++i)
+	{
+		double s{ s_min + (i + 0.5) * ds };
+		double sqrt_s{ std::sqrt(s) };
+		double p_cm2{ (s - (m1 + m2) * (m1 + m2)) * (s - (m1 - m2) * (m1 - m2)) / (4.0 * s) };
+		integral += channel.cross_section(sqrt_s) * p_cm2 * sqrt_s * std::cyl_bessel_k(1.0, sqrt_s / temperature);
+	}
+	integral *= ds;
+
+	// GeV^6 to fm^-6, and mb to fm^2
+	double pi4{ std::pow(std::numbers::pi, 4) };
+	return channel.degeneracy_1 * channel.degeneracy_2 * temperature / (8.0 * pi4) * integral * 0.1 /
+	       std::pow(0.197, 6);
+}
+
+int
+main()
+{
+	TwoBodyChannel pion_pion{ .mass_1        = 0.1396,
+		                      .mass_2        = 0.1396,
+		                      .degeneracy_1  = 1.0,
+		                      .degeneracy_2  = 1.0,
+		                      .cross_section = { .model = CrossSectionModel::CONSTANT, .parameters = { 10.0, 0.0, 0.0 } } };
+	TwoBodyChannel pion_nucleon{ .mass_1        = 0.1396,
+		                         .mass_2        = 0.938,
+		                         .degeneracy_1  = 1.0,
+		                         .degeneracy_2  = 2.0,
+		                         .cross_section = { .model      = CrossSectionModel::BREIT_WIGNER,
+		                                            .parameters = { 200.0, 1.232, 0.117 } } };
+
+	bool passed{ true };
+	for (auto const& channel : { pion_pion, pion_nucleon })
+	{
+		RateTable table(channel, RateTableGrid{}, "");
+		for (double temperature : { 0.05, 0.15, 0.3 })
+		{
+			double expected{ midpoint_rate(channel, temperature) };
+			double error{ std::fabs(table(temperature) / expected - 1.0) };
+			print("m1 + m2 =", channel.mass_1 + channel.mass_2, "T =", temperature, "C =", table(temperature));
+			print("    direct", expected, "relative error", error);
+			passed = passed && error < 1e-3;
+		}
+	}
+
+	// Below the default grid, which starts at 0.01 GeV, the table is extrapolated. Close to the grid it stays accurate,
+	// far below it (the end of the Bjorken profile in main.cpp) it only has to remain finite and positive
+	RateTable table(pion_pion, RateTableGrid{}, "");
+	double    expected{ midpoint_rate(pion_pion, 0.005) };
+	double    error{ std::fabs(table(0.005) / expected - 1.0) };
+	print("extrapolated to T = 0.005: C =", table(0.005), "direct", expected, "relative error", error);
+	print("extrapolated to T = 0.0004: C =", table(0.0004));
+	passed = passed && error < 0.05 && table(0.0004) >= 0.0 && std::isfinite(table(0.0004));
+
+	print(passed ? "rate table check passed" : "rate table check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,34 @@
+set -e
+
+cwd=`pwd`
+test_dir=$(cd `dirname $0` && pwd)
+src_dir=${test_dir}/../ReactionNetwork
+build_dir=${test_dir}/build
+
+if [ -d $build_dir ]; then
+    rm -rf $build_dir
+fi
+
+mkdir -p $build_dir
+cd $build_dir
+
+flags="-Wall -Wpedantic -Wextra -std=c++20 -O2 -march=native -fno-trapping-math -fno-math-errno"
+compiler=${CXX:-clang++}
+
+for src in `find ${src_dir} -name *.cpp | grep -v main`;
+do
+    $compiler $flags -c $src
+done
+
+# Every check is run from the test directory, where its input files live, and returns non-zero on failure
+cd $test_dir
+checks=${@:-`ls *_check.cpp | sed 's/\.cpp$//'`}
+failed=0
+for check in $checks;
+do
+    $compiler $flags -o ${build_dir}/${check} ${check}.cpp ${build_dir}/*.o -pthread
+    ${build_dir}/${check} || failed=1
+done
+
+cd $cwd
+exit $failed
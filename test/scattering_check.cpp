@@ -0,0 +1,100 @@
+// Scatterings on the toy network at constant temperature and volume, starting with twice the equilibrium number of
+// neutral pions. The channel pi0 pi0 -> pi+ pi- (`pion_exchange.dat`) has a repeated reactant, which loses two
+// particles per reaction; `DENSITY`, `DENSITY_RATIO` and `Ensemble<double>` have to agree on it. `DENSITY` is only
+// held to 10^-4, because its inverse decays use the product densities at the start of the step in every RK4 stage.
+//
+// Decays and scatterings have to use the same units. For a narrow resonance R -> pi+ pi- (`narrow_resonance.dat`), the
+// pi+ pi- -> R rate with a Breit-Wigner cross section at the unitarity limit, sigma_max = 4 pi g_R / (g_1 g_2 p^2),
+// equals the thermally averaged decay rate Gamma <M/E> n_R,eq = Gamma g_R M^2 T K_1(M/T) / (2 pi^2)
+
+#include <cmath>
+#include <numbers>
+
+#include "../ReactionNetwork/ensemble.hpp"
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/profile_source.hpp"
+#include "../ReactionNetwork/reaction_network.hpp"
+
+constexpr double tau_0{ 1.0 };
+constexpr double temperature{ 0.15 };
+constexpr double dt{ 0.01 };
+constexpr int    num_steps{ 200 };
+
+static ReactionNetwork
+make_network(void)
+{
+	ReactionNetwork rn("particles.dat", "decays.dat");
+	rn.add_scatterings("pion_exchange.dat", "");
+	rn.initialize_system(tau_0, temperature);
+	auto pi0{ rn.get_particle_list()[111] };
+	pi0->set_density(2.0 * pi0->get_density());
+	return rn;
+}
+
+int
+main()
+{
+	auto profile{ std::make_shared<AnalyticProfile>(
+		[](double) -> double { return temperature; },
+		[](double) -> double { return 1.0; }
+	) };
+
+	auto density{ make_network() };
+	auto ratio{ make_network() };
+	ratio.set_evolution_mode(EvolutionMode::DENSITY_RATIO, 211);
+
+	auto             ensemble_network{ make_network() };
+	Ensemble<double> ensemble(ensemble_network, { profile });
+	ensemble.initialize_system(tau_0);
+	ensemble.set_density(0, 111, ensemble_network.get_particle_density(111));
+
+	for (int n{ 0 }; n < num_steps; ++n)
+	{
+		density.time_step(dt, *profile);
+		ratio.time_step(dt, *profile);
+		ensemble.time_step(dt);
+	}
+
+	bool passed{ true };
+	for (long pid : { 111L, 211L })
+	{
+		double expected{ ensemble.get_density(0, pid) };
+		double density_error{ std::fabs(density.get_particle_density(pid) / expected - 1.0) };
+		double ratio_error{ std::fabs(ratio.get_particle_density(pid) / expected - 1.0) };
+		print("pid", pid, "ensemble", expected, "DENSITY error", density_error, "DENSITY_RATIO error", ratio_error);
+		passed = passed && density_error < 1e-4 && ratio_error < 1e-5;
+	}
+
+	// Formation of a narrow resonance against its decay rate, as loaded by the network
+	{
+		ReactionNetwork rn("narrow_resonance.dat", "narrow_resonance_decays.dat");
+		auto            resonance{ rn.get_particle_list()[9000223] };
+		auto            pion{ rn.get_particle_list()[211] };
+		double          mass{ resonance->get_mass() };
+		double          pion_mass{ pion->get_mass() };
+		double          decay_rate{ resonance->get_reactions()[0].reaction_rate };
+
+		// sigma_max in GeV^-2, converted to mb (1 fm^2 = 10 mb)
+		double momentum_squared{ 0.25 * mass * mass - pion_mass * pion_mass };
+		double sigma_max{ 4.0 * std::numbers::pi * resonance->get_degeneracy() / momentum_squared * hbar * hbar * 10.0 };
+		TwoBodyChannel channel{ .mass_1        = pion_mass,
+			                    .mass_2        = pion_mass,
+			                    .degeneracy_1  = 1.0,
+			                    .degeneracy_2  = 1.0,
+			                    .cross_section = { .model      = CrossSectionModel::BREIT_WIGNER,
+			                                       .parameters = { sigma_max, mass, resonance->get_decay_width() } } };
+		RateTable formation(channel, RateTableGrid{}, "");
+
+		double z{ mass / temperature };
+		double k1{ bessel_k1_scaled(z) * std::exp(-z) };
+		double dilated_density{ resonance->get_degeneracy() * mass * mass * temperature * k1 /
+			                    (2.0 * std::numbers::pi * std::numbers::pi * hbar * hbar * hbar) };
+		double error{ std::fabs(formation(temperature) / (decay_rate * dilated_density) - 1.0) };
+		print("narrow resonance: formation", formation(temperature), "decay", decay_rate * dilated_density,
+		      "relative error", error);
+		passed = passed && error < 1e-2;
+	}
+
+	print(passed ? "scattering check passed" : "scattering check FAILED");
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+// Maximum error of the batched kernels in thermal_kernels.hpp against glibc, in units in the last place, on 10^7
+// random arguments
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../ReactionNetwork/print.hpp"
+#include "../ReactionNetwork/thermal_kernels.hpp"
+
+static std::int64_t
+ulp_distance(double a, double b)
+{
+	if (a == b) return 0;
+	auto difference{ std::bit_cast<std::int64_t>(a) - std::bit_cast<std::int64_t>(b) };
+	return difference < 0 ? -difference : difference;
+}
+
+int
+main()
+{
+	std::size_t                            samples{ 10000000 };
+	std::mt19937_64                        generator(1);
+	std::uniform_real_distribution<double> wide(-708.0, 708.0);
+	std::uniform_real_distribution<double> positive(0.0, 1e6);
+
+	std::vector<double> x(samples);
+	std::vector<double> y(samples);
+	std::vector<double> exp_result(samples);
+	std::vector<double> expm1_result(samples);
+	std::vector<double> sqrt_result(samples);
+	for (std::size_t i{ 0 }; i < samples; ++i)
+	{
+		x[i] = wide(generator);
+		y[i] = positive(generator);
+	}
+	batch_exp(x, exp_result);
+	batch_expm1(x, expm1_result);
+	batch_sqrt(y, sqrt_result);
+
+	std::int64_t exp_error{ 0 };
+	std::int64_t expm1_error{ 0 };
+	std::int64_t sqrt_error{ 0 };
+	for (std::size_t i{ 0 }; i < samples; ++i)
+	{
+		exp_error   = std::max(exp_error, ulp_distance(exp_result[i], std::exp(x[i])));
+		expm1_error = std::max(expm1_error, ulp_distance(expm1_result[i], std::expm1(x[i])));
+		sqrt_error  = std::max(sqrt_error, ulp_distance(sqrt_result[i], std::sqrt(y[i])));
+	}
+
+	// Small arguments, where expm1 uses its own polynomial
+	std::uniform_real_distribution<double> small(-1.0, 1.0);
+	for (std::size_t i{ 0 }; i < samples; ++i)
+		x[i] = small(generator);
+	batch_expm1(x, expm1_result);
+	for (std::size_t i{ 0 }; i < samples; ++i)
+		expm1_error = std::max(expm1_error, ulp_distance(expm1_result[i], std::expm1(x[i])));
+
+	print("max ULP error: exp", exp_error, "expm1", expm1_error, "sqrt", sqrt_error);
+	bool passed{ exp_error <= 1 && expm1_error <= 2 && sqrt_error == 0 };
+	print(passed ? "thermal kernels check passed" : "thermal kernels check FAILED");
+	return passed ? 0 : 1;
+}